@@ -0,0 +1,343 @@
+#include "../CPU/CPU.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+
+/*
+
+    BENCHMARK
+
+    Three workloads, each run on every DISPATCH backend (or the one given with --backend):
+
+    program : a whole 64KB image, e.g. Klaus Dormann's 6502_functional_test.bin
+              (--program <file> [--entry 0x0400]), run until it traps in a jump/branch to itself.
+              Instructions are counted once with tick(), timed runs use run() for the same cycles.
+    opcodes : for every OPCODE that does not change control flow (and every branch, with an offset of 0),
+              a loop of LOOP_LENGTH copies followed by JMP back. Operands point at RAM so
+              each addressing mode reads/writes memory the way it normally does.
+    frames  : a frame loop that keeps reading and writing PPU registers ($2000-$3FFF, stubbed here),
+              so every access makes the CPU catch the PPU up, with vblank events on.
+
+    Every measurement is the median of --repeat timed runs after one warm up run.
+    Results go to stdout (or --json <file>) as JSON, a summary goes to stderr.
+
+*/
+
+using namespace std;
+
+namespace
+{
+    using CLOCK = chrono::steady_clock;
+
+    const ADDRESS LOOP_START = 0x0400;
+    const int LOOP_LENGTH = 64;
+    const BYTE ZERO_PAGE_OPERAND = 0x10; // holds a pointer to ABSOLUTE_OPERAND for (zp,X) and (zp),Y
+    const ADDRESS ABSOLUTE_OPERAND = 0x0300;
+
+    struct OPTIONS
+    {
+        vector<CPU::DISPATCH> backends = { CPU::DISPATCH::JUMP_TABLE,CPU::DISPATCH::SWITCH,CPU::DISPATCH::BLOCK_CACHE,CPU::DISPATCH::JIT };
+        const char* program = nullptr;
+        ADDRESS entry = 0x0400;
+        uint64_t programCycles = 200000000; // give up if the program has not trapped by then
+        uint64_t opcodeCycles = 2000000;
+        uint32_t frames = 600;
+        int repeat = 5;
+        const char* json = nullptr;
+    };
+
+    // One machine with its own memory, rebuilt for every timed run so runs do not share state
+    struct MACHINE
+    {
+        unique_ptr<RAM> ram{new RAM()};
+        PPU ppu;
+        unique_ptr<CPU> cpu;
+
+        MACHINE(CPU::DISPATCH dispatch,const vector<BYTE>& image,ADDRESS entry,bool events)
+        {
+            for(size_t i = 0;i < image.size();i++)
+                ram->writeToMemory(i,image[i]);
+            cpu.reset(new CPU(*ram,ppu,dispatch));
+            cpu->setProgramCounter(entry);
+            if(!events) cpu->getScheduler().cancel(Scheduler::PPU_VBLANK); // pure CPU workloads
+        }
+    };
+
+    struct TIMING
+    {
+        double seconds;  // median
+        uint64_t cycles; // emulated in one run
+    };
+
+    const char* backendName(CPU::DISPATCH dispatch)
+    {
+        switch(dispatch)
+        {
+            case CPU::DISPATCH::JUMP_TABLE: return "JUMP_TABLE";
+            case CPU::DISPATCH::SWITCH: return "SWITCH";
+            case CPU::DISPATCH::BLOCK_CACHE: return "BLOCK_CACHE";
+            case CPU::DISPATCH::JIT: return "JIT";
+        }
+        return "?";
+    }
+
+    // Runs run(machine) once to warm up and repeat times timed, returns the median
+    template<typename SETUP,typename RUN>
+    TIMING measure(int repeat,SETUP setup,RUN run)
+    {
+        vector<double> seconds;
+        uint64_t cycles = 0;
+        for(int i = 0;i <= repeat;i++)
+        {
+            unique_ptr<MACHINE> machine = setup();
+            uint64_t firstCycle = machine->cpu->getCycleIndex();
+            CLOCK::time_point start = CLOCK::now();
+            run(*machine);
+            double elapsed = chrono::duration<double>(CLOCK::now() - start).count();
+            cycles = machine->cpu->getCycleIndex() - firstCycle;
+            if(i) seconds.push_back(elapsed); // first run is the warm up
+        }
+        sort(seconds.begin(),seconds.end());
+        return { seconds[seconds.size() / 2],cycles };
+    }
+
+    bool isTrap(const MACHINE& machine,ADDRESS pc) // JMP * or a branch to itself
+    {
+        BYTE opcode = machine.ram->readFromMemory(pc);
+        if(opcode == 0x4C)
+            return (machine.ram->readFromMemory(pc + 1) | (machine.ram->readFromMemory(pc + 2) << 8)) == pc;
+        return OPCODES[opcode].addr == AddrMode::REL && machine.ram->readFromMemory(pc + 1) == 0xFE;
+    }
+
+    /*------------WORKLOADS------------*/
+
+    vector<BYTE> opcodeLoop(uint8_t opcode)
+    {
+        vector<BYTE> image(0x10000,0x00);
+        image[ZERO_PAGE_OPERAND] = ABSOLUTE_OPERAND & 0xFF;
+        image[ZERO_PAGE_OPERAND + 1] = ABSOLUTE_OPERAND >> 8;
+
+        const OPCODE& info = OPCODES[opcode];
+        ADDRESS pc = LOOP_START;
+        for(int i = 0;i < LOOP_LENGTH;i++)
+        {
+            image[pc++] = opcode;
+            switch(info.addr)
+            {
+                case AddrMode::IMM: image[pc++] = 0x01; break;
+                case AddrMode::ZER: case AddrMode::ZEX: case AddrMode::ZEY:
+                case AddrMode::INX: case AddrMode::INY: image[pc++] = ZERO_PAGE_OPERAND; break;
+                case AddrMode::ABS: case AddrMode::ABX: case AddrMode::ABY:
+                    image[pc++] = ABSOLUTE_OPERAND & 0xFF;
+                    image[pc++] = ABSOLUTE_OPERAND >> 8;
+                    break;
+                case AddrMode::REL: image[pc++] = 0x00; break; // taken or not, continues with the next copy
+                default: break;
+            }
+        }
+        image[pc++] = 0x4C; // JMP LOOP_START
+        image[pc++] = LOOP_START & 0xFF;
+        image[pc++] = LOOP_START >> 8;
+        return image;
+    }
+
+    bool isBenchmarked(uint8_t opcode)
+    {
+        const OPCODE& info = OPCODES[opcode];
+        if(info.addr == AddrMode::REL) return true;
+        return !changesControlFlow(info.operation);
+    }
+
+    BYTE ppuRegisterRead(void* context,ADDRESS address)
+    {
+        uint8_t& status = *static_cast<uint8_t*>(context);
+        return status ^= 0x80; // vblank bit toggles, loops polling it do not spin forever
+    }
+
+    void ppuRegisterWrite(void* context,ADDRESS address,BYTE value) { }
+
+    vector<BYTE> frameLoop()
+    {
+        vector<BYTE> image(0x10000,0x00);
+        const BYTE program[] =
+        {
+            0xAD,0x02,0x20, // LDA $2002
+            0x8D,0x06,0x20, // STA $2006
+            0xE8,           // INX
+            0x8E,0x07,0x20, // STX $2007
+            0xB5,0x10,      // LDA $10,X
+            0x69,0x01,      // ADC #$01
+            0x95,0x10,      // STA $10,X
+            0x4C,0x00,0x04  // JMP $0400
+        };
+        copy(begin(program),end(program),image.begin() + LOOP_START);
+        return image;
+    }
+
+    /*------------REPORT------------*/
+
+    string json;
+
+    void emit(const char* format,...) __attribute__((format(printf,1,2)));
+
+    void emit(const char* format,...)
+    {
+        char buffer[512];
+        va_list args;
+        va_start(args,format);
+        vsnprintf(buffer,sizeof(buffer),format,args);
+        va_end(args);
+        json += buffer;
+    }
+
+    bool parse(int argc,char** argv,OPTIONS& options)
+    {
+        for(int i = 1;i < argc;i++)
+        {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if(arg == "--backend" && hasValue)
+            {
+                string name = argv[++i];
+                options.backends.clear();
+                for(CPU::DISPATCH dispatch : { CPU::DISPATCH::JUMP_TABLE,CPU::DISPATCH::SWITCH,CPU::DISPATCH::BLOCK_CACHE,CPU::DISPATCH::JIT })
+                    if(name == backendName(dispatch)) options.backends.push_back(dispatch);
+                if(options.backends.empty()) return false;
+            }
+            else if(arg == "--program" && hasValue) options.program = argv[++i];
+            else if(arg == "--entry" && hasValue) options.entry = strtoul(argv[++i],nullptr,0);
+            else if(arg == "--program-cycles" && hasValue) options.programCycles = strtoull(argv[++i],nullptr,0);
+            else if(arg == "--opcode-cycles" && hasValue) options.opcodeCycles = strtoull(argv[++i],nullptr,0);
+            else if(arg == "--frames" && hasValue) options.frames = strtoul(argv[++i],nullptr,0);
+            else if(arg == "--repeat" && hasValue) options.repeat = max(1,atoi(argv[++i]));
+            else if(arg == "--json" && hasValue) options.json = argv[++i];
+            else return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc,char** argv)
+{
+    OPTIONS options;
+    if(!parse(argc,argv,options))
+    {
+        fprintf(stderr,"usage: %s [--backend JUMP_TABLE|SWITCH|BLOCK_CACHE|JIT] [--program file.bin [--entry addr]]\n"
+                       "          [--program-cycles n] [--opcode-cycles n] [--frames n] [--repeat n] [--json file]\n",argv[0]);
+        return 2;
+    }
+
+    // Program image and its instruction count, the same for every backend
+    vector<BYTE> programImage;
+    uint64_t programInstructions = 0,programCycles = 0;
+    ADDRESS trapAddress = 0;
+    if(options.program)
+    {
+        FILE* file = fopen(options.program,"rb");
+        if(!file)
+        {
+            fprintf(stderr,"cannot open %s\n",options.program);
+            return 1;
+        }
+        programImage.resize(0x10000);
+        programImage.resize(fread(programImage.data(),1,programImage.size(),file));
+        fclose(file);
+
+        MACHINE reference(CPU::DISPATCH::SWITCH,programImage,options.entry,false);
+        while(reference.cpu->getCycleIndex() < options.programCycles && !isTrap(reference,reference.cpu->getProgramCounter()))
+        {
+            reference.cpu->tick();
+            programInstructions++;
+        }
+        programCycles = reference.cpu->getCycleIndex();
+        trapAddress = reference.cpu->getProgramCounter();
+    }
+
+    emit("{\n  \"loop_length\": %d,\n  \"repeat\": %d,\n  \"backends\": [\n",LOOP_LENGTH,options.repeat);
+    for(size_t b = 0;b < options.backends.size();b++)
+    {
+        CPU::DISPATCH dispatch = options.backends[b];
+        emit("    {\n      \"backend\": \"%s\",\n",backendName(dispatch));
+
+        /* PROGRAM */
+        if(options.program)
+        {
+            TIMING timing = measure(options.repeat,
+                [&] { return unique_ptr<MACHINE>(new MACHINE(dispatch,programImage,options.entry,false)); },
+                [&](MACHINE& machine) { machine.cpu->run(programCycles); });
+            emit("      \"program\": { \"file\": \"%s\", \"trap\": \"0x%04X\", \"instructions\": %llu, \"cycles\": %llu, "
+                 "\"seconds\": %.6f, \"mhz\": %.3f, \"ns_per_instruction\": %.3f },\n",
+                 options.program,trapAddress,(unsigned long long)programInstructions,(unsigned long long)timing.cycles,
+                 timing.seconds,timing.cycles / timing.seconds / 1e6,timing.seconds * 1e9 / programInstructions);
+            fprintf(stderr,"%-12s program   %8.2f MHz %7.2f ns/instruction (trap 0x%04X)\n",backendName(dispatch),
+                    timing.cycles / timing.seconds / 1e6,timing.seconds * 1e9 / programInstructions,trapAddress);
+        }
+        else emit("      \"program\": null,\n");
+
+        /* OPCODES */
+        emit("      \"opcodes\": [\n");
+        double totalNs = 0;
+        int count = 0;
+        for(int opcode = 0;opcode < 256;opcode++)
+        {
+            if(!isBenchmarked(opcode)) continue;
+            vector<BYTE> image = opcodeLoop(opcode);
+
+            // Cycles of one pass through the loop, the same on every pass: no loop changes the index register
+            // it indexes with or the flag it branches on, so page crossings and taken branches repeat exactly
+            MACHINE probe(CPU::DISPATCH::SWITCH,image,LOOP_START,false);
+            for(int i = 0;i <= LOOP_LENGTH;i++)
+                probe.cpu->tick();
+            uint64_t loopCycles = probe.cpu->getCycleIndex();
+
+            TIMING timing = measure(options.repeat,
+                [&] { return unique_ptr<MACHINE>(new MACHINE(dispatch,image,LOOP_START,false)); },
+                [&](MACHINE& machine) { machine.cpu->run(options.opcodeCycles); });
+            double instructions = (double)timing.cycles / loopCycles * (LOOP_LENGTH + 1);
+            double ns = timing.seconds * 1e9 / instructions;
+            totalNs += ns;
+            count++;
+
+            const OPCODE& info = OPCODES[opcode];
+            emit("%s        { \"opcode\": \"0x%02X\", \"mnemonic\": \"%s\", \"mode\": \"%s\", \"mhz\": %.3f, \"ns_per_instruction\": %.3f }",
+                 count > 1 ? ",\n" : "",opcode,mnemonicName(info.operation),addrModeName(info.addr),timing.cycles / timing.seconds / 1e6,ns);
+        }
+        emit("\n      ],\n");
+        fprintf(stderr,"%-12s opcodes   %8s     %7.2f ns/instruction (mean of %d)\n",backendName(dispatch),"",totalNs / count,count);
+
+        /* FRAMES */
+        vector<BYTE> image = frameLoop();
+        TIMING timing = measure(options.repeat,
+            [&]
+            {
+                unique_ptr<MACHINE> machine(new MACHINE(dispatch,image,LOOP_START,true));
+                static uint8_t status = 0;
+                machine->cpu->getBus().mapHandler(0x20,0x3F,&ppuRegisterRead,&ppuRegisterWrite,&status);
+                return machine;
+            },
+            [&](MACHINE& machine) { machine.cpu->runFrames(options.frames); });
+        emit("      \"frames\": { \"frames\": %u, \"cycles\": %llu, \"seconds\": %.6f, \"mhz\": %.3f, \"ns_per_frame\": %.1f }\n",
+             options.frames,(unsigned long long)timing.cycles,timing.seconds,timing.cycles / timing.seconds / 1e6,timing.seconds * 1e9 / options.frames);
+        fprintf(stderr,"%-12s frames    %8.2f MHz %10.0f ns/frame\n",backendName(dispatch),
+                timing.cycles / timing.seconds / 1e6,timing.seconds * 1e9 / options.frames);
+
+        emit("    }%s\n",b + 1 < options.backends.size() ? "," : "");
+    }
+    emit("  ]\n}\n");
+
+    FILE* out = options.json ? fopen(options.json,"w") : stdout;
+    if(!out)
+    {
+        fprintf(stderr,"cannot write %s\n",options.json);
+        return 1;
+    }
+    fputs(json.c_str(),out);
+    if(out != stdout) fclose(out);
+    return 0;
+}
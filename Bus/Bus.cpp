@@ -0,0 +1,69 @@
+#include "Bus.h"
+
+Bus::Bus()
+{
+    unmap(0x00,0xFF);
+}
+
+void Bus::mapMemory(uint8_t firstPage,uint8_t lastPage,BYTE* host,uint32_t size,bool writable)
+{
+    for(int page = firstPage;page <= lastPage;page++)
+    {
+        BYTE* base = host + ((page - firstPage) * 0x100) % size;
+        pages[page].read = base;
+        pages[page].write = writable ? base : nullptr;
+        mmio[page] = { nullptr,nullptr,nullptr,false };
+        backing[page] = nullptr;
+    }
+    dirtyEpoch++; // saved pages no longer match the mapping
+    mappingEpoch++;
+    updateLowMemory();
+}
+
+void Bus::mapHandler(uint8_t firstPage,uint8_t lastPage,READ_HANDLER readHandler,WRITE_HANDLER writeHandler,void* context,bool stable)
+{
+    for(int page = firstPage;page <= lastPage;page++)
+    {
+        pages[page].read = nullptr;
+        pages[page].write = nullptr;
+        mmio[page] = { readHandler ? readHandler : &Bus::openBus,writeHandler,context,stable };
+        backing[page] = nullptr;
+    }
+    dirtyEpoch++;
+    mappingEpoch++;
+    updateLowMemory();
+}
+
+void Bus::unmap(uint8_t firstPage,uint8_t lastPage)
+{
+    mapHandler(firstPage,lastPage,nullptr,nullptr,nullptr,true);
+}
+
+void Bus::restorePage(uint8_t page,const PAGE& entry,const MMIO& handler)
+{
+    pages[page] = entry;
+    mmio[page] = handler;
+    backing[page] = nullptr;
+    dirtyEpoch++;
+    mappingEpoch++;
+    updateLowMemory();
+}
+
+uint32_t Bus::clearDirty()
+{
+    for(int i = 0;i < 4;i++)
+        dirtyPages[i] = 0;
+    return ++dirtyEpoch;
+}
+
+void Bus::updateLowMemory()
+{
+    BYTE* low = pages[0].read;
+    bool ram = low && pages[0].write == low && pages[1].read == low + 0x100 && pages[1].write == low + 0x100;
+    lowMemory = ram ? low : nullptr; // a hooked or read only page goes back through read()/write()
+}
+
+BYTE Bus::openBus(void* context,ADDRESS address)
+{
+    return address >> 8; // last value on the data bus is usually the high byte of the address
+}
@@ -0,0 +1,125 @@
+#ifndef BUS_H
+#define BUS_H
+#include "../Utils/handler.h"
+
+/*
+
+    MEMORY BUS
+
+    The 64KB address space is split in 256 pages of 256 bytes.
+    Each page either points straight into host memory (RAM,ROM) or
+    goes through a read/write handler (PPU,APU,mapper registers).
+    Reads and writes to host memory pages are a single indexed load/store,
+    only MMIO pages pay for a call.
+    Host pointers (PAGE) and handlers (MMIO) are kept in separate tables,
+    so the 4KB the CPU reads on every access holds nothing but pointers.
+    Zero page and stack are RAM on every machine, while they are mapped that way
+    the CPU reaches them through one pointer (getLowMemory()) without a page lookup.
+    Writes to host memory pages are recorded in a dirty page bitmap so save states
+    only copy pages that changed since the last checkpoint.
+
+*/
+
+class Bus
+{
+    public:
+        using READ_HANDLER = BYTE (*)(void* context,ADDRESS address);
+        using WRITE_HANDLER = void (*)(void* context,ADDRESS address,BYTE value);
+
+        struct PAGE
+        {
+            BYTE* read;  // host memory for reads, nullptr when MMIO::read is used
+            BYTE* write; // host memory for writes, nullptr when MMIO::write is used (or write is ignored)
+        };
+
+        struct MMIO
+        {
+            READ_HANDLER read;
+            WRITE_HANDLER write;
+            void* context;
+            bool stable; // reads give the same value until the next scheduled event and reading again changes nothing
+        };
+
+        Bus(); // every page starts unmapped (open bus)
+
+        // Map pages [firstPage,lastPage] to host memory, host is mirrored every size bytes (multiple of 256)
+        void mapMemory(uint8_t firstPage,uint8_t lastPage,BYTE* host,uint32_t size,bool writable = true);
+
+        // stable pages may be polled by loops the CPU fast-forwards (CPU::setIdleLoopSkip()), e.g. a status register
+        // whose bits only change in scheduled events
+        void mapHandler(uint8_t firstPage,uint8_t lastPage,READ_HANDLER readHandler,WRITE_HANDLER writeHandler,void* context,bool stable = false);
+
+        void unmap(uint8_t firstPage,uint8_t lastPage); // open bus, which is stable
+
+        void restorePage(uint8_t page,const PAGE& entry,const MMIO& handler); // put back what getPage()/getMMIO() returned
+
+        const PAGE& getPage(ADDRESS address) const { return pages[address >> 8]; }
+
+        const MMIO& getMMIO(ADDRESS address) const { return mmio[address >> 8]; } // only meaningful if the PAGE pointer is nullptr
+
+        // RAM behind a page whose handlers forward to it (Debugger watchpoints), save states still copy it.
+        // Cleared by every remap of the page
+        void setBackingPage(uint8_t page,BYTE* host) { backing[page] = host; }
+
+        BYTE* getBackingPage(ADDRESS address) const // writable host memory of a page, mapped directly or behind its handlers
+        {
+            const PAGE& page = pages[address >> 8];
+            return page.write ? page.write : backing[address >> 8];
+        }
+
+        // $0000-$01FF as one block of writable host memory, nullptr unless pages 0 and 1 are RAM mapped back to back
+        BYTE* getLowMemory() const { return lowMemory; }
+
+        BYTE read(ADDRESS address) const
+        {
+            const PAGE& page = pages[address >> 8];
+            if(page.read) return page.read[address & 0xFF];
+            const MMIO& handler = mmio[address >> 8];
+            return handler.read(handler.context,address);
+        }
+
+        void write(ADDRESS address,BYTE value)
+        {
+            const PAGE& page = pages[address >> 8];
+            if(page.write)
+            {
+                page.write[address & 0xFF] = value;
+                markDirty(address);
+                return;
+            }
+            const MMIO& handler = mmio[address >> 8];
+            if(handler.write) handler.write(handler.context,address,value);
+        }
+
+        /*------------DIRTY PAGE TRACKING------------*/
+        void markDirty(ADDRESS address) { dirtyPages[address >> 14] |= 1ULL << ((address >> 8) & 63); }
+
+        bool isDirty(uint8_t page) const { return dirtyPages[page >> 6] & (1ULL << (page & 63)); }
+
+        const uint64_t* getDirtyPages() const { return dirtyPages; } // 4 words, bit per page
+
+        uint64_t* getDirtyBitmap() { return dirtyPages; } // for generated code that marks pages itself
+
+        uint32_t clearDirty(); // start a new checkpoint, returns its epoch
+
+        uint32_t getDirtyEpoch() const { return dirtyEpoch; } // changes on every clearDirty() and remap
+
+        uint32_t getMappingEpoch() const { return mappingEpoch; } // changes on every remap (bank switch)
+
+    private:
+        PAGE pages[256];
+        MMIO mmio[256];
+        BYTE* backing[256];
+        BYTE* lowMemory = nullptr; // zero page and stack, refreshed on every remap
+
+        void updateLowMemory();
+
+        uint64_t dirtyPages[4] = { 0,0,0,0 };
+        uint32_t dirtyEpoch = 0;
+        uint32_t mappingEpoch = 0;
+
+        static BYTE openBus(void* context,ADDRESS address);
+};
+
+
+#endif
@@ -0,0 +1,99 @@
+#include "Cartridge.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <algorithm>
+
+Cartridge::Cartridge(const char* path)
+{
+    int file = open(path,O_RDONLY);
+    if(file < 0) return;
+
+    struct stat info;
+    if(fstat(file,&info) || info.st_size < (off_t)HEADER_SIZE)
+    {
+        close(file);
+        return;
+    }
+    void* memory = mmap(nullptr,info.st_size,PROT_READ,MAP_PRIVATE,file,0); // never written, pages stay shared
+    close(file); // mapping keeps the file
+    if(memory == MAP_FAILED) return;
+
+    image = static_cast<BYTE*>(memory);
+    imageSize = info.st_size;
+    if(!parse())
+    {
+        munmap(image,imageSize);
+        image = nullptr;
+    }
+}
+
+Cartridge::~Cartridge()
+{
+    if(image) munmap(image,imageSize);
+}
+
+bool Cartridge::parse()
+{
+    const BYTE* header = image;
+    if(memcmp(header,"NES\x1A",4)) return false;
+
+    uint8_t flags6 = header[6],flags7 = header[7];
+    nes2 = (flags7 & 0x0C) == 0x08;
+    mirroring = (flags6 & 0x08) ? MIRRORING::FOUR_SCREEN : (flags6 & 0x01) ? MIRRORING::VERTICAL : MIRRORING::HORIZONTAL;
+    battery = flags6 & 0x02;
+
+    uint64_t prgBytes,chrBytes;
+    if(nes2)
+    {
+        mapper = (flags6 >> 4) | (flags7 & 0xF0) | ((header[8] & 0x0F) << 8);
+        submapper = header[8] >> 4;
+        prgBytes = romSize(header[4],header[9] & 0x0F,0x4000);
+        chrBytes = romSize(header[5],header[9] >> 4,0x2000);
+    }
+    else
+    {
+        // Old dumps have garbage ("DiskDude!") in bytes 7-15, their upper mapper nibble is not trusted
+        bool archaic = (flags7 & 0x0C) == 0x04 || header[12] || header[13] || header[14] || header[15];
+        mapper = (flags6 >> 4) | (archaic ? 0 : flags7 & 0xF0);
+        submapper = 0;
+        prgBytes = header[4] * 0x4000ULL;
+        chrBytes = header[5] * 0x2000ULL;
+    }
+
+    uint64_t offset = HEADER_SIZE + ((flags6 & 0x04) ? TRAINER_SIZE : 0);
+    if(!prgBytes || prgBytes > UINT32_MAX || chrBytes > UINT32_MAX) return false; // sizes are kept in 32 bits
+    // Truncated image, each size is checked against what is left on its own so a huge header value can not wrap the sum
+    if(offset > imageSize || prgBytes > imageSize - offset || chrBytes > imageSize - offset - prgBytes) return false;
+
+    prg = image + offset;
+    prgSize = prgBytes;
+    chr = chrBytes ? prg + prgBytes : nullptr;
+    chrSize = chrBytes;
+    return true;
+}
+
+uint64_t Cartridge::romSize(uint8_t lsb,uint8_t msb,uint32_t unit)
+{
+    if(msb != 0x0F) return ((uint64_t)msb << 8 | lsb) * unit;
+    uint8_t exponent = lsb >> 2,multiplier = (lsb & 0x03) * 2 + 1; // EEEEEEMM: 2^E * (MM*2+1) bytes
+    if(exponent > 40) return UINT64_MAX; // larger than any file, parse() rejects it
+    return (1ULL << exponent) * multiplier;
+}
+
+bool Cartridge::mapPRG(Bus& bus,uint8_t firstPage,uint8_t lastPage,uint32_t offset) const
+{
+    if(!image || firstPage > lastPage || offset >= prgSize) return false;
+    uint32_t size = std::min<uint32_t>(prgSize - offset,(lastPage - firstPage + 1) * 0x100);
+    if(size % 0x100) return false; // Bus mirrors whole pages only
+    bus.mapMemory(firstPage,lastPage,const_cast<BYTE*>(prg + offset),size,false); // writes to ROM are ignored
+    return true;
+}
+
+bool Cartridge::map(Bus& bus) const
+{
+    if(mapper != 0) return false;
+    return mapPRG(bus,0x80,0xFF,0);
+}
@@ -0,0 +1,84 @@
+#ifndef CARTRIDGE_H
+#define CARTRIDGE_H
+#include "../Utils/handler.h"
+#include "Bus.h"
+
+/*
+
+    CARTRIDGE
+
+    Loads .nes images (iNES and NES 2.0). The file is mapped read-only and never copied:
+    PRG-ROM and CHR-ROM are pointers into the mapping, and map() points Bus pages straight at them.
+    Every Cartridge of the same file shares the same physical pages through the page cache,
+    so a farm running thousands of machines on one ROM keeps a single copy,
+    and opening one costs little more than the mmap call.
+
+    The header gives the mapper, mirroring, battery and the PRG/CHR sizes (NES 2.0 exponent sizes too).
+    A trainer, if there is one, is skipped. map() sets up mapper 0 (NROM) only. For other mappers the
+    host lays out the power-on banks with mapPRG(), and maps them again on bank switches.
+    CHR-ROM is for the PPU to read pattern tables from. A CHR size of 0 means the board has CHR-RAM.
+
+*/
+
+class Cartridge
+{
+    public:
+        enum class MIRRORING : uint8_t { HORIZONTAL,VERTICAL,FOUR_SCREEN };
+
+        static const uint32_t HEADER_SIZE = 16;
+        static const uint32_t TRAINER_SIZE = 512;
+
+        explicit Cartridge(const char* path); // isOpen() is false if the file cannot be mapped or is not a valid image
+
+        ~Cartridge();
+
+        Cartridge(const Cartridge&) = delete;
+
+        bool isOpen() const { return image != nullptr; }
+
+        bool isNES2() const { return nes2; }
+
+        uint16_t getMapper() const { return mapper; }
+
+        uint8_t getSubmapper() const { return submapper; } // NES 2.0 only, 0 otherwise
+
+        MIRRORING getMirroring() const { return mirroring; }
+
+        bool hasBattery() const { return battery; } // PRG-RAM at $6000-$7FFF is kept when the power is off
+
+        const BYTE* getPRG() const { return prg; }
+
+        uint32_t getPRGSize() const { return prgSize; }
+
+        const BYTE* getCHR() const { return chr; } // nullptr when the board has CHR-RAM
+
+        uint32_t getCHRSize() const { return chrSize; }
+
+        // Map pages [firstPage,lastPage] read-only to PRG-ROM starting at offset. The bank is mirrored
+        // if it is shorter than the range. Returns false if the bank is not inside PRG-ROM.
+        bool mapPRG(Bus& bus,uint8_t firstPage,uint8_t lastPage,uint32_t offset) const;
+
+        bool map(Bus& bus) const; // NROM: PRG-ROM at $8000-$FFFF, 16KB images mirrored. false for other mappers
+
+    private:
+        BYTE* image = nullptr; // the whole file
+        size_t imageSize = 0;
+
+        const BYTE* prg = nullptr;
+        const BYTE* chr = nullptr;
+        uint32_t prgSize = 0;
+        uint32_t chrSize = 0;
+
+        uint16_t mapper = 0;
+        uint8_t submapper = 0;
+        MIRRORING mirroring = MIRRORING::HORIZONTAL;
+        bool battery = false;
+        bool nes2 = false;
+
+        bool parse(); // header -> fields above, false if the image is not valid
+
+        static uint64_t romSize(uint8_t lsb,uint8_t msb,uint32_t unit); // NES 2.0 size field, msb is 4 bits
+};
+
+
+#endif
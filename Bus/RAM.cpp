@@ -2,7 +2,7 @@
 #include <iostream>
 #include <iomanip>
 
-RAM::RAM()
+RAM::RAM() : memory() // zeroed, machines built from RAM start from the same state
 {
     //memory = new uint8_t[64 * 1024](); // Allocate 64KB memory for RAM of NES 
 }
@@ -0,0 +1,471 @@
+#include "BatchCPU.h"
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+
+// Kernels are plain loops over one chunk, the compiler emits AVX-512 (x86-64-v4), AVX2 (x86-64-v3) and SSE2 versions
+// and the loader picks one for the host CPU
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#define BATCH_KERNEL __attribute__((target_clones("arch=x86-64-v4","arch=x86-64-v3","default")))
+#else
+#define BATCH_KERNEL
+#endif
+
+namespace
+{
+	const size_t CHUNK = BatchCPU::CHUNK_LANES;
+
+	const uint8_t CARRY_FLAG = 1 << CARRY_BIT;
+	const uint8_t DECIMAL_FLAG = 1 << DECIMAL_MODE_BIT;
+	const uint8_t OVERFLOW_FLAG = 1 << OVERFLOW_BIT;
+
+	enum class BRANCH_FLAG { CARRY,ZERO,NEGATIVE,OVERFLOW };
+
+	enum class SHIFT { ASL,LSR,ROL,ROR };
+
+	/*------------KERNELS------------*/
+	// Same results as the CPU.h operations, written as selects so masked lanes keep their values
+
+	BATCH_KERNEL void kernelLoad(uint8_t* __restrict reg,uint16_t* __restrict nz,const uint8_t* __restrict value,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			reg[i] = mask[i] ? value[i] : reg[i];
+			nz[i] = mask[i] ? value[i] : nz[i];
+		}
+	}
+
+	BATCH_KERNEL void kernelLogic(Mnemonic operation,uint8_t* __restrict A,uint16_t* __restrict nz,const uint8_t* __restrict value,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			uint8_t result = operation == Mnemonic::AND ? A[i] & value[i] : operation == Mnemonic::ORA ? A[i] | value[i] : A[i] ^ value[i];
+			A[i] = mask[i] ? result : A[i];
+			nz[i] = mask[i] ? result : nz[i];
+		}
+	}
+
+	BATCH_KERNEL void kernelAdc(uint8_t* __restrict A,uint8_t* __restrict P,uint16_t* __restrict nz,const uint8_t* __restrict value,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			uint16_t temp = A[i] + value[i] + (P[i] & CARRY_FLAG);
+			uint8_t overflow = (~(A[i] ^ value[i]) & (A[i] ^ temp) & 0x80) >> (7 - OVERFLOW_BIT);
+			uint8_t status = (P[i] & ~(CARRY_FLAG | OVERFLOW_FLAG)) | (temp >> 8) | overflow;
+			A[i] = mask[i] ? (uint8_t)temp : A[i];
+			P[i] = mask[i] ? status : P[i];
+			nz[i] = mask[i] ? (uint8_t)temp : nz[i];
+		}
+	}
+
+	BATCH_KERNEL void kernelSbc(uint8_t* __restrict A,uint8_t* __restrict P,uint16_t* __restrict nz,const uint8_t* __restrict value,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			uint16_t temp = A[i] - value[i] - ((P[i] & CARRY_FLAG) ^ 1);
+			uint8_t overflow = ((A[i] ^ temp) & (A[i] ^ value[i]) & 0x80) >> (7 - OVERFLOW_BIT);
+			uint8_t status = (P[i] & ~(CARRY_FLAG | OVERFLOW_FLAG)) | (temp < 0x100) | overflow;
+			A[i] = mask[i] ? (uint8_t)temp : A[i];
+			P[i] = mask[i] ? status : P[i];
+			nz[i] = mask[i] ? (uint8_t)temp : nz[i];
+		}
+	}
+
+	BATCH_KERNEL void kernelCompare(const uint8_t* __restrict reg,uint8_t* __restrict P,uint16_t* __restrict nz,const uint8_t* __restrict value,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			uint8_t status = (P[i] & ~CARRY_FLAG) | (reg[i] >= value[i]);
+			P[i] = mask[i] ? status : P[i];
+			nz[i] = mask[i] ? (uint8_t)(reg[i] - value[i]) : nz[i];
+		}
+	}
+
+	BATCH_KERNEL void kernelTransfer(uint8_t* __restrict dst,const uint8_t* __restrict src,uint16_t* __restrict nz,bool flags,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			dst[i] = mask[i] ? src[i] : dst[i];
+			nz[i] = (mask[i] && flags) ? src[i] : nz[i];
+		}
+	}
+
+	BATCH_KERNEL void kernelIncrement(uint8_t* __restrict reg,uint16_t* __restrict nz,uint8_t delta,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			uint8_t result = reg[i] + delta;
+			reg[i] = mask[i] ? result : reg[i];
+			nz[i] = mask[i] ? result : nz[i];
+		}
+	}
+
+	BATCH_KERNEL void kernelFlags(uint8_t* __restrict P,uint8_t clear,uint8_t set,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+			P[i] = mask[i] ? (uint8_t)((P[i] & ~clear) | set) : P[i];
+	}
+
+	BATCH_KERNEL void kernelShift(SHIFT shift,uint8_t* __restrict A,uint8_t* __restrict P,uint16_t* __restrict nz,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			uint8_t carryIn = P[i] & CARRY_FLAG;
+			bool left = shift == SHIFT::ASL || shift == SHIFT::ROL;
+			bool rotate = shift == SHIFT::ROL || shift == SHIFT::ROR;
+			uint8_t result = left ? (uint8_t)((A[i] << 1) | (rotate ? carryIn : 0)) : (uint8_t)((A[i] >> 1) | (rotate ? carryIn << 7 : 0));
+			uint8_t carryOut = left ? A[i] >> 7 : A[i] & 0x01;
+			P[i] = mask[i] ? (uint8_t)((P[i] & ~CARRY_FLAG) | carryOut) : P[i];
+			A[i] = mask[i] ? result : A[i];
+			nz[i] = mask[i] ? result : nz[i];
+		}
+	}
+
+	BATCH_KERNEL void kernelBranch(BRANCH_FLAG flag,bool takenIfSet,uint16_t* __restrict programCounter,uint64_t* __restrict currentCycle,const uint8_t* __restrict P,const uint16_t* __restrict nz,const uint16_t* __restrict target,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			bool set = flag == BRANCH_FLAG::CARRY ? (P[i] & CARRY_FLAG) != 0 :
+					   flag == BRANCH_FLAG::OVERFLOW ? (P[i] & OVERFLOW_FLAG) != 0 :
+					   flag == BRANCH_FLAG::ZERO ? (nz[i] & 0xFF) == 0 :
+					   ((nz[i] | (nz[i] >> 8)) & 0x80) != 0;
+			bool taken = mask[i] && set == takenIfSet;
+			currentCycle[i] += taken ? 1 + ((programCounter[i] ^ target[i]) > 0xFF) : 0; // like CPU::BRANCH
+			programCounter[i] = taken ? target[i] : programCounter[i];
+		}
+	}
+
+	BATCH_KERNEL void kernelJump(uint16_t* __restrict programCounter,const uint16_t* __restrict target,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+			programCounter[i] = mask[i] ? target[i] : programCounter[i];
+	}
+
+	BATCH_KERNEL void kernelAdvance(uint16_t* __restrict programCounter,uint64_t* __restrict currentCycle,uint8_t length,uint8_t cycles,const uint8_t* __restrict mask)
+	{
+		for(size_t i = 0;i < CHUNK;i++)
+		{
+			programCounter[i] += mask[i] ? length : 0;
+			currentCycle[i] += mask[i] ? cycles : 0;
+		}
+	}
+
+	/*------------OPERANDS------------*/
+	// Effective address exactly like the CPU.h addressing modes, lanes have flat memory so reads have no side effects
+	ADDRESS effectiveAddress(const BYTE* memory,ADDRESS programCounter,AddrMode mode,uint8_t X,uint8_t Y)
+	{
+		ADDRESS operand = programCounter + 1;
+		uint8_t low = memory[operand];
+		ADDRESS absolute = low | (memory[(ADDRESS)(operand + 1)] << 8);
+		switch(mode)
+		{
+			case AddrMode::IMM: return operand;
+			case AddrMode::ZER: return low;
+			case AddrMode::ZEX: return (uint8_t)(low + X);
+			case AddrMode::ZEY: return (uint8_t)(low + Y);
+			case AddrMode::ABS: return absolute;
+			case AddrMode::ABX: return absolute + X;
+			case AddrMode::ABY: return absolute + Y;
+			case AddrMode::INX: { uint8_t zero = low + X; return memory[zero] | (memory[(uint8_t)(zero + 1)] << 8); }
+			case AddrMode::INY: return (memory[low] | (memory[(uint8_t)(low + 1)] << 8)) + Y;
+			case AddrMode::ZPI: return memory[low] | (memory[(uint8_t)(low + 1)] << 8);
+			case AddrMode::REL: return operand + 1 + (int8_t)low;
+			default: return 0;
+		}
+	}
+}
+
+BatchCPU::LANE::LANE(PPU& ppu,Variant variant) : memory(new BYTE[0x10000]()),cpu(bus,ppu,CPU::DISPATCH::SWITCH,variant)
+{
+	bus.mapMemory(0x00,0xFF,memory.get(),0x10000);
+	cpu.getScheduler().cancel(Scheduler::PPU_VBLANK); // tick() must never drive the shared PPU
+}
+
+BatchCPU::BatchCPU(size_t lanes,Variant variant) : laneCount(lanes),slotCount((lanes + CHUNK_LANES - 1) / CHUNK_LANES * CHUNK_LANES),variant(variant)
+{
+	A.assign(slotCount,0x00);
+	X.assign(slotCount,0x00);
+	Y.assign(slotCount,0x00);
+	SP.assign(slotCount,0xFF);
+	P.assign(slotCount,0x00);
+	nz.assign(slotCount,0x01); // same power on state as CPU
+	programCounter.assign(slotCount,0x0000);
+	currentCycle.assign(slotCount,0);
+	halted.assign(slotCount,1); // padding slots never run
+	memory.assign(slotCount,nullptr);
+	slotLane.assign(slotCount,UINT32_MAX);
+	laneSlot.resize(laneCount);
+
+	for(size_t lane = 0;lane < laneCount;lane++)
+	{
+		this->lanes.emplace_back(new LANE(ppu,variant));
+		memory[lane] = this->lanes[lane]->memory.get();
+		slotLane[lane] = lane;
+		laneSlot[lane] = lane;
+		halted[lane] = 0;
+	}
+}
+
+BatchCPU::~BatchCPU() { }
+
+BYTE* BatchCPU::getMemory(size_t lane)
+{
+	return lanes[lane]->memory.get();
+}
+
+void BatchCPU::setProgramCounter(size_t lane,ADDRESS address)
+{
+	programCounter[laneSlot[lane]] = address;
+	halted[laneSlot[lane]] = 0;
+}
+
+BatchCPU::REGISTERS BatchCPU::getRegisters(size_t lane) const
+{
+	size_t slot = laneSlot[lane];
+	uint16_t result = nz[slot];
+	uint8_t status = P[slot] | ((result & 0xFF) ? 0 : 1 << ZERO_BIT) | ((result | (result >> 8)) & 0x80); // CPU::status()
+	return { A[slot],X[slot],Y[slot],SP[slot],status,programCounter[slot],currentCycle[slot],halted[slot] != 0 };
+}
+
+uint64_t BatchCPU::run(uint64_t steps)
+{
+	auto start = std::chrono::steady_clock::now();
+	uint64_t executed = 0;
+
+	for(uint64_t step = 0;step < steps;step++)
+	{
+		uint64_t executedStep = 0;
+		for(size_t base = 0;base < slotCount;base += CHUNK_LANES)
+			executedStep += stepChunk(base);
+		executed += executedStep;
+		if(!executedStep) break; // every lane halted
+
+		// Chunks needing more than one group on average have diverged, put lanes at the same PC together
+		if((step + 1) % REGROUP_INTERVAL == 0)
+		{
+			if(groups > chunks + chunks / 4) regroup();
+			groups = chunks = 0;
+		}
+	}
+
+	stats.instructions += executed;
+	stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return executed;
+}
+
+uint32_t BatchCPU::stepChunk(size_t base)
+{
+	uint8_t opcode[CHUNK_LANES];
+	uint32_t pending = 0;
+	for(size_t i = 0;i < CHUNK_LANES;i++)
+	{
+		size_t slot = base + i;
+		if(halted[slot]) continue;
+		opcode[i] = memory[slot][programCounter[slot]]; // Fetch
+		pending |= 1u << i;
+	}
+	if(!pending) return 0;
+
+	uint32_t executed = __builtin_popcount(pending);
+	chunks++;
+
+	// Lanes that fetched the same OPCODE run as one group, the others wait for their own group
+	while(pending)
+	{
+		uint8_t current = opcode[__builtin_ctz(pending)];
+		uint8_t mask[CHUNK_LANES];
+		for(size_t i = 0;i < CHUNK_LANES;i++)
+		{
+			mask[i] = ((pending >> i) & 1) && opcode[i] == current;
+			pending &= ~((uint32_t)mask[i] << i);
+		}
+		groups++;
+		stats.vectorInstructions += executeGroup(base,current,mask);
+	}
+	return executed;
+}
+
+uint32_t BatchCPU::executeGroup(size_t base,uint8_t opcode,uint8_t* mask)
+{
+	const OPCODE& info = opcodeTable(variant)[opcode];
+	Mnemonic operation = info.operation;
+
+	bool readsOperand = false,writesOperand = false;
+	switch(operation)
+	{
+		case Mnemonic::LDA: case Mnemonic::LDX: case Mnemonic::LDY:
+		case Mnemonic::AND: case Mnemonic::ORA: case Mnemonic::EOR:
+		case Mnemonic::ADC: case Mnemonic::SBC:
+		case Mnemonic::CMP: case Mnemonic::CPX: case Mnemonic::CPY:
+			readsOperand = true;
+			break;
+		case Mnemonic::STA: case Mnemonic::STX: case Mnemonic::STY:
+			writesOperand = true;
+			break;
+		case Mnemonic::TAX: case Mnemonic::TAY: case Mnemonic::TXA: case Mnemonic::TYA:
+		case Mnemonic::TSX: case Mnemonic::TXS:
+		case Mnemonic::INX_OP: case Mnemonic::INY_OP: case Mnemonic::DEX: case Mnemonic::DEY:
+		case Mnemonic::ASL_ACC: case Mnemonic::LSR_ACC: case Mnemonic::ROL_ACC: case Mnemonic::ROR_ACC:
+		case Mnemonic::CLC: case Mnemonic::SEC: case Mnemonic::CLV: case Mnemonic::CLD: case Mnemonic::SED:
+		case Mnemonic::NOP:
+		case Mnemonic::BCC: case Mnemonic::BCS: case Mnemonic::BEQ: case Mnemonic::BNE:
+		case Mnemonic::BMI: case Mnemonic::BPL: case Mnemonic::BVC: case Mnemonic::BVS:
+			break;
+		case Mnemonic::JMP:
+			if(info.addr == AddrMode::ABS) break;
+			// fallthrough, indirect JMP keeps its page wrap quirk in CPU.h
+		default:
+			for(size_t i = 0;i < CHUNK_LANES;i++)
+				if(mask[i]) fallback(base + i);
+			return 0;
+	}
+
+	// Decimal mode ADC/SBC stays with CPU.h
+	uint32_t lanesRun = 0;
+	for(size_t i = 0;i < CHUNK_LANES;i++)
+	{
+		if(mask[i] && hasDecimalMode(variant) && (operation == Mnemonic::ADC || operation == Mnemonic::SBC) && (P[base + i] & DECIMAL_FLAG))
+		{
+			fallback(base + i);
+			mask[i] = 0;
+		}
+		lanesRun += mask[i];
+	}
+
+	bool pageCrossCycle = addsPageCrossCycle(variant,operation,info.addr);
+	uint8_t value[CHUNK_LANES] = { 0 };
+	uint16_t address[CHUNK_LANES] = { 0 };
+	if(readsOperand || writesOperand || info.addr == AddrMode::REL || info.addr == AddrMode::ABS)
+		for(size_t i = 0;i < CHUNK_LANES;i++)
+		{
+			if(!mask[i]) continue;
+			size_t slot = base + i;
+			address[i] = effectiveAddress(memory[slot],programCounter[slot],info.addr,X[slot],Y[slot]);
+			if(readsOperand) value[i] = memory[slot][address[i]]; // gather
+			if(pageCrossCycle)
+			{
+				ADDRESS unindexed = address[i] - (info.addr == AddrMode::ABX ? X[slot] : Y[slot]);
+				currentCycle[slot] += (unindexed ^ address[i]) > 0xFF;
+			}
+		}
+
+	size_t b = base;
+	kernelAdvance(&programCounter[b],&currentCycle[b],1 + operandLength(info.addr),info.cycles,mask);
+
+	switch(operation)
+	{
+		case Mnemonic::LDA: kernelLoad(&A[b],&nz[b],value,mask); break;
+		case Mnemonic::LDX: kernelLoad(&X[b],&nz[b],value,mask); break;
+		case Mnemonic::LDY: kernelLoad(&Y[b],&nz[b],value,mask); break;
+		case Mnemonic::AND: case Mnemonic::ORA: case Mnemonic::EOR: kernelLogic(operation,&A[b],&nz[b],value,mask); break;
+		case Mnemonic::ADC: kernelAdc(&A[b],&P[b],&nz[b],value,mask); break;
+		case Mnemonic::SBC: kernelSbc(&A[b],&P[b],&nz[b],value,mask); break;
+		case Mnemonic::CMP: kernelCompare(&A[b],&P[b],&nz[b],value,mask); break;
+		case Mnemonic::CPX: kernelCompare(&X[b],&P[b],&nz[b],value,mask); break;
+		case Mnemonic::CPY: kernelCompare(&Y[b],&P[b],&nz[b],value,mask); break;
+
+		case Mnemonic::STA: case Mnemonic::STX: case Mnemonic::STY:
+		{
+			const std::vector<uint8_t>& reg = operation == Mnemonic::STA ? A : operation == Mnemonic::STX ? X : Y;
+			for(size_t i = 0;i < CHUNK_LANES;i++)
+				if(mask[i]) memory[b + i][address[i]] = reg[b + i]; // scatter
+			break;
+		}
+
+		case Mnemonic::TAX: kernelTransfer(&X[b],&A[b],&nz[b],true,mask); break;
+		case Mnemonic::TAY: kernelTransfer(&Y[b],&A[b],&nz[b],true,mask); break;
+		case Mnemonic::TXA: kernelTransfer(&A[b],&X[b],&nz[b],true,mask); break;
+		case Mnemonic::TYA: kernelTransfer(&A[b],&Y[b],&nz[b],true,mask); break;
+		case Mnemonic::TSX: kernelTransfer(&X[b],&SP[b],&nz[b],true,mask); break;
+		case Mnemonic::TXS: kernelTransfer(&SP[b],&X[b],&nz[b],false,mask); break;
+
+		case Mnemonic::INX_OP: kernelIncrement(&X[b],&nz[b],1,mask); break;
+		case Mnemonic::INY_OP: kernelIncrement(&Y[b],&nz[b],1,mask); break;
+		case Mnemonic::DEX: kernelIncrement(&X[b],&nz[b],0xFF,mask); break;
+		case Mnemonic::DEY: kernelIncrement(&Y[b],&nz[b],0xFF,mask); break;
+
+		case Mnemonic::ASL_ACC: kernelShift(SHIFT::ASL,&A[b],&P[b],&nz[b],mask); break;
+		case Mnemonic::LSR_ACC: kernelShift(SHIFT::LSR,&A[b],&P[b],&nz[b],mask); break;
+		case Mnemonic::ROL_ACC: kernelShift(SHIFT::ROL,&A[b],&P[b],&nz[b],mask); break;
+		case Mnemonic::ROR_ACC: kernelShift(SHIFT::ROR,&A[b],&P[b],&nz[b],mask); break;
+
+		case Mnemonic::CLC: kernelFlags(&P[b],CARRY_FLAG,0,mask); break;
+		case Mnemonic::SEC: kernelFlags(&P[b],0,CARRY_FLAG,mask); break;
+		case Mnemonic::CLV: kernelFlags(&P[b],OVERFLOW_FLAG,0,mask); break;
+		case Mnemonic::CLD: kernelFlags(&P[b],DECIMAL_FLAG,0,mask); break;
+		case Mnemonic::SED: kernelFlags(&P[b],0,DECIMAL_FLAG,mask); break;
+
+		case Mnemonic::BCC: kernelBranch(BRANCH_FLAG::CARRY,false,&programCounter[b],&currentCycle[b],&P[b],&nz[b],address,mask); break;
+		case Mnemonic::BCS: kernelBranch(BRANCH_FLAG::CARRY,true,&programCounter[b],&currentCycle[b],&P[b],&nz[b],address,mask); break;
+		case Mnemonic::BNE: kernelBranch(BRANCH_FLAG::ZERO,false,&programCounter[b],&currentCycle[b],&P[b],&nz[b],address,mask); break;
+		case Mnemonic::BEQ: kernelBranch(BRANCH_FLAG::ZERO,true,&programCounter[b],&currentCycle[b],&P[b],&nz[b],address,mask); break;
+		case Mnemonic::BPL: kernelBranch(BRANCH_FLAG::NEGATIVE,false,&programCounter[b],&currentCycle[b],&P[b],&nz[b],address,mask); break;
+		case Mnemonic::BMI: kernelBranch(BRANCH_FLAG::NEGATIVE,true,&programCounter[b],&currentCycle[b],&P[b],&nz[b],address,mask); break;
+		case Mnemonic::BVC: kernelBranch(BRANCH_FLAG::OVERFLOW,false,&programCounter[b],&currentCycle[b],&P[b],&nz[b],address,mask); break;
+		case Mnemonic::BVS: kernelBranch(BRANCH_FLAG::OVERFLOW,true,&programCounter[b],&currentCycle[b],&P[b],&nz[b],address,mask); break;
+
+		case Mnemonic::JMP: kernelJump(&programCounter[b],address,mask); break;
+
+		default: break; // NOP
+	}
+
+	return lanesRun;
+}
+
+void BatchCPU::fallback(size_t slot)
+{
+	CPU& cpu = lanes[slotLane[slot]]->cpu;
+	cpu.A = A[slot];
+	cpu.X = X[slot];
+	cpu.Y = Y[slot];
+	cpu.SP = SP[slot];
+	cpu.P = P[slot];
+	cpu.nz = nz[slot];
+	cpu.programCounter = programCounter[slot];
+	cpu.currentCycle = currentCycle[slot];
+	cpu.halted = false;
+
+	cpu.tick();
+
+	A[slot] = cpu.A;
+	X[slot] = cpu.X;
+	Y[slot] = cpu.Y;
+	SP[slot] = cpu.SP;
+	P[slot] = cpu.P;
+	nz[slot] = cpu.nz;
+	programCounter[slot] = cpu.programCounter;
+	currentCycle[slot] = cpu.currentCycle;
+	halted[slot] = cpu.halted;
+}
+
+void BatchCPU::regroup()
+{
+	// Running lanes sorted by PC, halted lanes and padding go to the back
+	std::vector<uint32_t> order(slotCount);
+	std::iota(order.begin(),order.end(),0);
+	std::stable_sort(order.begin(),order.end(),[this](uint32_t a,uint32_t b)
+	{
+		return ((uint32_t)halted[a] << 16 | programCounter[a]) < ((uint32_t)halted[b] << 16 | programCounter[b]);
+	});
+
+	auto permute = [this,&order](auto& values)
+	{
+		auto copy = values;
+		for(size_t slot = 0;slot < slotCount;slot++)
+			values[slot] = copy[order[slot]];
+	};
+	permute(A);
+	permute(X);
+	permute(Y);
+	permute(SP);
+	permute(P);
+	permute(halted);
+	permute(nz);
+	permute(programCounter);
+	permute(currentCycle);
+	permute(memory);
+	permute(slotLane);
+
+	for(size_t slot = 0;slot < slotCount;slot++)
+		if(slotLane[slot] != UINT32_MAX) laneSlot[slotLane[slot]] = slot;
+}
@@ -0,0 +1,109 @@
+#ifndef BATCHCPU_H
+#define BATCHCPU_H
+
+#include "CPU.h"
+#include <vector>
+#include <memory>
+
+/*
+
+    BATCH CPU
+
+    Runs many independent 6502 instances (lanes) of the same program, e.g. one ROM with
+    different inputs for fuzzing. Each lane has its own flat 64KB memory and no MMIO.
+
+    Registers of all lanes are kept as structure of arrays and lanes are stepped in
+    chunks of CHUNK_LANES. Lanes of a chunk that fetched the same OPCODE run together
+    through one masked kernel, vectorized for AVX-512/AVX2 (picked at runtime) on x86-64 Linux.
+    OPCODEs without a kernel run lane by lane through a CPU of their own,
+    so every instruction keeps the exact semantics of CPU.h.
+    When lanes drift apart, slots are regrouped by PC so lanes at the same
+    code share chunks again.
+
+    Lanes ignore timing events (no PPU, no interrupts), cycles are still counted.
+    All lanes are the same Variant, kernels decode with its OPCODE table and an RP2A03 batch
+    never falls back for decimal mode.
+
+*/
+
+class BatchCPU
+{
+    public:
+        static const size_t CHUNK_LANES = 32;
+
+        struct REGISTERS // one lane as the host sees it
+        {
+            uint8_t A,X,Y,SP,P; // P as PHP pushes it, without B and bit 5
+            ADDRESS programCounter;
+            uint64_t currentCycle;
+            bool halted;
+        };
+
+        struct STATS
+        {
+            uint64_t instructions = 0;       // over all lanes
+            uint64_t vectorInstructions = 0; // part of instructions that ran in a kernel
+            double seconds = 0;              // wall time spent in run()
+
+            double getInstructionsPerSecond() const { return seconds > 0 ? instructions / seconds : 0; } // aggregate
+        };
+
+        explicit BatchCPU(size_t lanes,Variant variant = Variant::NMOS);
+
+        ~BatchCPU();
+
+        BatchCPU(const BatchCPU&) = delete;
+
+        size_t getLaneCount() const { return laneCount; }
+
+        BYTE* getMemory(size_t lane); // 64KB of lane, load ROM and inputs here
+
+        void setProgramCounter(size_t lane,ADDRESS address); // also clears halted
+
+        REGISTERS getRegisters(size_t lane) const;
+
+        uint64_t run(uint64_t steps); // every lane executes up to steps instructions, returns instructions executed
+
+        const STATS& getStats() const { return stats; }
+
+    private:
+        static const uint32_t REGROUP_INTERVAL = 64; // steps between divergence checks
+
+        struct LANE // memory and scalar fallback of one lane
+        {
+            std::unique_ptr<BYTE[]> memory;
+            Bus bus;
+            CPU cpu;
+
+            LANE(PPU& ppu,Variant variant);
+        };
+
+        size_t laneCount;
+        size_t slotCount; // laneCount rounded up to CHUNK_LANES, padding slots stay halted
+        Variant variant;
+
+        PPU ppu; // never driven, lanes have no PPU
+        std::vector<std::unique_ptr<LANE>> lanes;
+
+        /*------REGISTER FILE, indexed by slot------*/
+        std::vector<uint8_t> A,X,Y,SP,P,halted;
+        std::vector<uint16_t> nz,programCounter;
+        std::vector<uint64_t> currentCycle;
+        std::vector<BYTE*> memory;
+        std::vector<uint32_t> slotLane; // lane of each slot
+        std::vector<uint32_t> laneSlot; // slot of each lane
+
+        STATS stats;
+        uint64_t groups = 0,chunks = 0; // since the last regroup check
+
+        uint32_t stepChunk(size_t base); // instructions executed
+
+        uint32_t executeGroup(size_t base,uint8_t opcode,uint8_t* mask); // lanes run in a kernel, the others go through fallback()
+
+        void fallback(size_t slot); // one instruction through the lane CPU
+
+        void regroup(); // sort slots by PC
+};
+
+
+#endif
@@ -1,682 +1,213 @@
 #include "CPU.h"
 #include <iostream>
-#include <functional>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
 using namespace std;
 
-CPU::CPU(RAM& mem,PPU& ppu) : memory(mem),ppu(ppu) { 
-
-    // Fill with ILLEGAL for empty OPCODES 
-    INSTRUCTION temp; 
-    temp.operation = &CPU::ILLEGAL;
-    temp.addr = &CPU::IMP;
-    temp.cycles = 0;
-    for(int i;i < 256;i++)
-        table[i] = temp;
-    
-    // Fill table now
-    temp.addr = &CPU::IMM;
-	temp.operation = &CPU::ADC;
-	temp.cycles = 2;
-	table[0x69] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::ADC;
-	temp.cycles = 4;
-	table[0x6D] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::ADC;
-	temp.cycles = 3;
-	table[0x65] = temp;
-	temp.addr = &CPU::INX;
-	temp.operation = &CPU::ADC;
-	temp.cycles = 6;
-	table[0x61] = temp;
-	temp.addr = &CPU::INY;
-	temp.operation = &CPU::ADC;
-	temp.cycles = 6;
-	table[0x71] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::ADC;
-	temp.cycles = 4;
-	table[0x75] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::ADC;
-	temp.cycles = 4;
-	table[0x7D] = temp;
-	temp.addr = &CPU::ABY;
-	temp.operation = &CPU::ADC;
-	temp.cycles = 4;
-	table[0x79] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::AND;
-	temp.cycles = 2;
-	table[0x29] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::AND;
-	temp.cycles = 4;
-	table[0x2D] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::AND;
-	temp.cycles = 3;
-	table[0x25] = temp;
-	temp.addr = &CPU::INX;
-	temp.operation = &CPU::AND;
-	temp.cycles = 6;
-	table[0x21] = temp;
-	temp.addr = &CPU::INY;
-	temp.operation = &CPU::AND;
-	temp.cycles = 5;
-	table[0x31] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::AND;
-	temp.cycles = 4;
-	table[0x35] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::AND;
-	temp.cycles = 4;
-	table[0x3D] = temp;
-	temp.addr = &CPU::ABY;
-	temp.operation = &CPU::AND;
-	temp.cycles = 4;
-	table[0x39] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::ASL;
-	temp.cycles = 6;
-	table[0x0E] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::ASL;
-	temp.cycles = 5;
-	table[0x06] = temp;
-	temp.addr = &CPU::ACC;
-	temp.operation = &CPU::ASL_ACC;
-	temp.cycles = 2;
-	table[0x0A] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::ASL;
-	temp.cycles = 6;
-	table[0x16] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::ASL;
-	temp.cycles = 7;
-	table[0x1E] = temp;
-
-	temp.addr = &CPU::REL;
-	temp.operation = &CPU::BCC;
-	temp.cycles = 2;
-	table[0x90] = temp;
-
-	temp.addr = &CPU::REL;
-	temp.operation = &CPU::BCS;
-	temp.cycles = 2;
-	table[0xB0] = temp;
-
-	temp.addr = &CPU::REL;
-	temp.operation = &CPU::BEQ;
-	temp.cycles = 2;
-	table[0xF0] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::BIT;
-	temp.cycles = 4;
-	table[0x2C] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::BIT;
-	temp.cycles = 3;
-	table[0x24] = temp;
-
-	temp.addr = &CPU::REL;
-	temp.operation = &CPU::BMI;
-	temp.cycles = 2;
-	table[0x30] = temp;
-
-	temp.addr = &CPU::REL;
-	temp.operation = &CPU::BNE;
-	temp.cycles = 2;
-	table[0xD0] = temp;
-
-	temp.addr = &CPU::REL;
-	temp.operation = &CPU::BPL;
-	temp.cycles = 2;
-	table[0x10] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::BRK;
-	temp.cycles = 7;
-	table[0x00] = temp;
-
-	temp.addr = &CPU::REL;
-	temp.operation = &CPU::BVC;
-	temp.cycles = 2;
-	table[0x50] = temp;
-
-	temp.addr = &CPU::REL;
-	temp.operation = &CPU::BVS;
-	temp.cycles = 2;
-	table[0x70] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::CLC;
-	temp.cycles = 2;
-	table[0x18] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::CLD;
-	temp.cycles = 2;
-	table[0xD8] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::CLI;
-	temp.cycles = 2;
-	table[0x58] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::CLV;
-	temp.cycles = 2;
-	table[0xB8] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::CMP;
-	temp.cycles = 2;
-	table[0xC9] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::CMP;
-	temp.cycles = 4;
-	table[0xCD] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::CMP;
-	temp.cycles = 3;
-	table[0xC5] = temp;
-	temp.addr = &CPU::INX;
-	temp.operation = &CPU::CMP;
-	temp.cycles = 6;
-	table[0xC1] = temp;
-	temp.addr = &CPU::INY;
-	temp.operation = &CPU::CMP;
-	temp.cycles = 3;
-	table[0xD1] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::CMP;
-	temp.cycles = 4;
-	table[0xD5] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::CMP;
-	temp.cycles = 4;
-	table[0xDD] = temp;
-	temp.addr = &CPU::ABY;
-	temp.operation = &CPU::CMP;
-	temp.cycles = 4;
-	table[0xD9] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::CPX;
-	temp.cycles = 2;
-	table[0xE0] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::CPX;
-	temp.cycles = 4;
-	table[0xEC] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::CPX;
-	temp.cycles = 3;
-	table[0xE4] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::CPY;
-	temp.cycles = 2;
-	table[0xC0] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::CPY;
-	temp.cycles = 4;
-	table[0xCC] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::CPY;
-	temp.cycles = 3;
-	table[0xC4] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::DEC;
-	temp.cycles = 6;
-	table[0xCE] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::DEC;
-	temp.cycles = 5;
-	table[0xC6] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::DEC;
-	temp.cycles = 6;
-	table[0xD6] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::DEC;
-	temp.cycles = 7;
-	table[0xDE] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::DEX;
-	temp.cycles = 2;
-	table[0xCA] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::DEY;
-	temp.cycles = 2;
-	table[0x88] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::EOR;
-	temp.cycles = 2;
-	table[0x49] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::EOR;
-	temp.cycles = 4;
-	table[0x4D] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::EOR;
-	temp.cycles = 3;
-	table[0x45] = temp;
-	temp.addr = &CPU::INX;
-	temp.operation = &CPU::EOR;
-	temp.cycles = 6;
-	table[0x41] = temp;
-	temp.addr = &CPU::INY;
-	temp.operation = &CPU::EOR;
-	temp.cycles = 5;
-	table[0x51] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::EOR;
-	temp.cycles = 4;
-	table[0x55] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::EOR;
-	temp.cycles = 4;
-	table[0x5D] = temp;
-	temp.addr = &CPU::ABY;
-	temp.operation = &CPU::EOR;
-	temp.cycles = 4;
-	table[0x59] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::INC;
-	temp.cycles = 6;
-	table[0xEE] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::INC;
-	temp.cycles = 5;
-	table[0xE6] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::INC;
-	temp.cycles = 6;
-	table[0xF6] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::INC;
-	temp.cycles = 7;
-	table[0xFE] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::INX_OP;
-	temp.cycles = 2;
-	table[0xE8] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::INY_OP;
-	temp.cycles = 2;
-	table[0xC8] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::JMP;
-	temp.cycles = 3;
-	table[0x4C] = temp;
-	temp.addr = &CPU::ABI;
-	temp.operation = &CPU::JMP;
-	temp.cycles = 5;
-	table[0x6C] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::JSR;
-	temp.cycles = 6;
-	table[0x20] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::LDA;
-	temp.cycles = 2;
-	table[0xA9] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::LDA;
-	temp.cycles = 4;
-	table[0xAD] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::LDA;
-	temp.cycles = 3;
-	table[0xA5] = temp;
-	temp.addr = &CPU::INX;
-	temp.operation = &CPU::LDA;
-	temp.cycles = 6;
-	table[0xA1] = temp;
-	temp.addr = &CPU::INY;
-	temp.operation = &CPU::LDA;
-	temp.cycles = 5;
-	table[0xB1] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::LDA;
-	temp.cycles = 4;
-	table[0xB5] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::LDA;
-	temp.cycles = 4;
-	table[0xBD] = temp;
-	temp.addr = &CPU::ABY;
-	temp.operation = &CPU::LDA;
-	temp.cycles = 4;
-	table[0xB9] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::LDX;
-	temp.cycles = 2;
-	table[0xA2] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::LDX;
-	temp.cycles = 4;
-	table[0xAE] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::LDX;
-	temp.cycles = 3;
-	table[0xA6] = temp;
-	temp.addr = &CPU::ABY;
-	temp.operation = &CPU::LDX;
-	temp.cycles = 4;
-	table[0xBE] = temp;
-	temp.addr = &CPU::ZEY;
-	temp.operation = &CPU::LDX;
-	temp.cycles = 4;
-	table[0xB6] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::LDY;
-	temp.cycles = 2;
-	table[0xA0] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::LDY;
-	temp.cycles = 4;
-	table[0xAC] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::LDY;
-	temp.cycles = 3;
-	table[0xA4] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::LDY;
-	temp.cycles = 4;
-	table[0xB4] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::LDY;
-	temp.cycles = 4;
-	table[0xBC] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::LSR;
-	temp.cycles = 6;
-	table[0x4E] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::LSR;
-	temp.cycles = 5;
-	table[0x46] = temp;
-	temp.addr = &CPU::ACC;
-	temp.operation = &CPU::LSR_ACC;
-	temp.cycles = 2;
-	table[0x4A] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::LSR;
-	temp.cycles = 6;
-	table[0x56] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::LSR;
-	temp.cycles = 7;
-	table[0x5E] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::NOP;
-	temp.cycles = 2;
-	table[0xEA] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::ORA;
-	temp.cycles = 2;
-	table[0x09] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::ORA;
-	temp.cycles = 4;
-	table[0x0D] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::ORA;
-	temp.cycles = 3;
-	table[0x05] = temp;
-	temp.addr = &CPU::INX;
-	temp.operation = &CPU::ORA;
-	temp.cycles = 6;
-	table[0x01] = temp;
-	temp.addr = &CPU::INY;
-	temp.operation = &CPU::ORA;
-	temp.cycles = 5;
-	table[0x11] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::ORA;
-	temp.cycles = 4;
-	table[0x15] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::ORA;
-	temp.cycles = 4;
-	table[0x1D] = temp;
-	temp.addr = &CPU::ABY;
-	temp.operation = &CPU::ORA;
-	temp.cycles = 4;
-	table[0x19] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::PHA;
-	temp.cycles = 3;
-	table[0x48] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::PHP;
-	temp.cycles = 3;
-	table[0x08] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::PLA;
-	temp.cycles = 4;
-	table[0x68] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::PLP;
-	temp.cycles = 4;
-	table[0x28] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::ROL;
-	temp.cycles = 6;
-	table[0x2E] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::ROL;
-	temp.cycles = 5;
-	table[0x26] = temp;
-	temp.addr = &CPU::ACC;
-	temp.operation = &CPU::ROL_ACC;
-	temp.cycles = 2;
-	table[0x2A] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::ROL;
-	temp.cycles = 6;
-	table[0x36] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::ROL;
-	temp.cycles = 7;
-	table[0x3E] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::ROR;
-	temp.cycles = 6;
-	table[0x6E] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::ROR;
-	temp.cycles = 5;
-	table[0x66] = temp;
-	temp.addr = &CPU::ACC;
-	temp.operation = &CPU::ROR_ACC;
-	temp.cycles = 2;
-	table[0x6A] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::ROR;
-	temp.cycles = 6;
-	table[0x76] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::ROR;
-	temp.cycles = 7;
-	table[0x7E] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::RTI;
-	temp.cycles = 6;
-	table[0x40] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::RTS;
-	temp.cycles = 6;
-	table[0x60] = temp;
-
-	temp.addr = &CPU::IMM;
-	temp.operation = &CPU::SBC;
-	temp.cycles = 2;
-	table[0xE9] = temp;
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::SBC;
-	temp.cycles = 4;
-	table[0xED] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::SBC;
-	temp.cycles = 3;
-	table[0xE5] = temp;
-	temp.addr = &CPU::INX;
-	temp.operation = &CPU::SBC;
-	temp.cycles = 6;
-	table[0xE1] = temp;
-	temp.addr = &CPU::INY;
-	temp.operation = &CPU::SBC;
-	temp.cycles = 5;
-	table[0xF1] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::SBC;
-	temp.cycles = 4;
-	table[0xF5] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::SBC;
-	temp.cycles = 4;
-	table[0xFD] = temp;
-	temp.addr = &CPU::ABY;
-	temp.operation = &CPU::SBC;
-	temp.cycles = 4;
-	table[0xF9] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::SEC;
-	temp.cycles = 2;
-	table[0x38] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::SED;
-	temp.cycles = 2;
-	table[0xF8] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::SEI;
-	temp.cycles = 2;
-	table[0x78] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::STA;
-	temp.cycles = 4;
-	table[0x8D] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::STA;
-	temp.cycles = 3;
-	table[0x85] = temp;
-	temp.addr = &CPU::INX;
-	temp.operation = &CPU::STA;
-	temp.cycles = 6;
-	table[0x81] = temp;
-	temp.addr = &CPU::INY;
-	temp.operation = &CPU::STA;
-	temp.cycles = 6;
-	table[0x91] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::STA;
-	temp.cycles = 4;
-	table[0x95] = temp;
-	temp.addr = &CPU::ABX;
-	temp.operation = &CPU::STA;
-	temp.cycles = 5;
-	table[0x9D] = temp;
-	temp.addr = &CPU::ABY;
-	temp.operation = &CPU::STA;
-	temp.cycles = 5;
-	table[0x99] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::STX;
-	temp.cycles = 4;
-	table[0x8E] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::STX;
-	temp.cycles = 3;
-	table[0x86] = temp;
-	temp.addr = &CPU::ZEY;
-	temp.operation = &CPU::STX;
-	temp.cycles = 4;
-	table[0x96] = temp;
-
-	temp.addr = &CPU::ABS;
-	temp.operation = &CPU::STY;
-	temp.cycles = 4;
-	table[0x8C] = temp;
-	temp.addr = &CPU::ZER;
-	temp.operation = &CPU::STY;
-	temp.cycles = 3;
-	table[0x84] = temp;
-	temp.addr = &CPU::ZEX;
-	temp.operation = &CPU::STY;
-	temp.cycles = 4;
-	table[0x94] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::TAX;
-	temp.cycles = 2;
-	table[0xAA] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::TAY;
-	temp.cycles = 2;
-	table[0xA8] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::TSX;
-	temp.cycles = 2;
-	table[0xBA] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::TXA;
-	temp.cycles = 2;
-	table[0x8A] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::TXS;
-	temp.cycles = 2;
-	table[0x9A] = temp;
-
-	temp.addr = &CPU::IMP;
-	temp.operation = &CPU::TYA;
-	temp.cycles = 2;
-	table[0x98] = temp;
+static_assert(alignof(CPU) == 64,"hot registers must start a cache line");
+
+CPU::CPU(Bus& bus,PPU& ppu,DISPATCH dispatch,Variant variant) : bus(bus),ppu(ppu),dispatch(dispatch),variant(variant) 
+{ 
+	initialize();
+}
+
+CPU::CPU(RAM& mem,PPU& ppu,DISPATCH dispatch,Variant variant) : bus(*new Bus()),ppu(ppu),dispatch(dispatch),variant(variant) 
+{ 
+	ownedBus.reset(&bus); // bus sits in the hot cache line, ownedBus is only constructed after it
+	bus.mapMemory(0x00,0xFF,mem.memory,0x10000); // flat 64KB until the host maps ROM and registers
+	initialize();
+}
+
+void CPU::initialize()
+{
+	if(dispatch == DISPATCH::BLOCK_CACHE || dispatch == DISPATCH::JIT)
+	{
+		blockCache.reset(new BLOCK_CACHE());
+		blockCache->mappingEpoch = bus.getMappingEpoch();
+	}
+
+	if(dispatch == DISPATCH::JIT)
+	{
+		jit.reset(new JIT(bus.getDirtyBitmap(),codePages,variant));
+		if(!jit->isAvailable()) jit.reset(); // plain block cache
+	}
+
+	scheduler.setHandler(Scheduler::PPU_VBLANK,&CPU::onVBlank,this);
+	scheduler.setHandler(Scheduler::NMI,&CPU::onNMI,this);
+	scheduler.setHandler(Scheduler::IRQ,&CPU::onIRQ,this);
+	scheduler.schedule(Scheduler::PPU_VBLANK,(nextVBlankDot + 2) / 3);
+}
+
+template<Variant VARIANT,AddrMode MODE,bool PAGE_CROSS_CYCLE>
+ADDRESS CPU::resolve()
+{
+	switch(MODE)
+	{
+		case AddrMode::ACC: return ACC();
+		case AddrMode::IMM: return IMM();
+		case AddrMode::ABS: return ABS();
+		case AddrMode::ZER: return ZER();
+		case AddrMode::ZEX: return ZEX();
+		case AddrMode::ZEY: return ZEY();
+		case AddrMode::ABX: return ABX<PAGE_CROSS_CYCLE>();
+		case AddrMode::ABY: return ABY<PAGE_CROSS_CYCLE>();
+		case AddrMode::IMP: return IMP();
+		case AddrMode::REL: return REL();
+		case AddrMode::INX: return INX();
+		case AddrMode::INY: return INY<PAGE_CROSS_CYCLE>();
+		case AddrMode::ABI: return ABI<VARIANT>();
+		case AddrMode::ZPI: return ZPI();
+		case AddrMode::AIX: return AIX();
+	}
+	return 0;
+}
+
+template<Variant VARIANT,Mnemonic OPERATION,AddrMode MODE>
+CPU::OPEXEC CPU::operate(ADDRESS source)
+{
+	switch(OPERATION)
+	{
+		case Mnemonic::ADC: ADC<VARIANT,MODE>(source); break;
+		case Mnemonic::AND: AND<MODE>(source); break;
+		case Mnemonic::ASL: ASL<MODE>(source); break;
+		case Mnemonic::ASL_ACC: ASL_ACC(source); break;
+		case Mnemonic::BCC: BCC(source); break;
+		case Mnemonic::BCS: BCS(source); break;
+		case Mnemonic::BEQ: BEQ(source); break;
+		case Mnemonic::BIT: BIT<MODE>(source); break;
+		case Mnemonic::BMI: BMI(source); break;
+		case Mnemonic::BNE: BNE(source); break;
+		case Mnemonic::BPL: BPL(source); break;
+		case Mnemonic::BRK: BRK<VARIANT>(source); break;
+		case Mnemonic::BVC: BVC(source); break;
+		case Mnemonic::BVS: BVS(source); break;
+		case Mnemonic::CLC: CLC(source); break;
+		case Mnemonic::CLD: CLD(source); break;
+		case Mnemonic::CLI: CLI(source); break;
+		case Mnemonic::CLV: CLV(source); break;
+		case Mnemonic::CMP: CMP<MODE>(source); break;
+		case Mnemonic::CPX: CPX<MODE>(source); break;
+		case Mnemonic::CPY: CPY<MODE>(source); break;
+		case Mnemonic::DEC: DEC<MODE>(source); break;
+		case Mnemonic::DEX: DEX(source); break;
+		case Mnemonic::DEY: DEY(source); break;
+		case Mnemonic::EOR: EOR<MODE>(source); break;
+		case Mnemonic::INC: INC<MODE>(source); break;
+		case Mnemonic::INX_OP: INX_OP(source); break;
+		case Mnemonic::INY_OP: INY_OP(source); break;
+		case Mnemonic::JMP: JMP(source); break;
+		case Mnemonic::JSR: JSR(source); break;
+		case Mnemonic::LDA: LDA<MODE>(source); break;
+		case Mnemonic::LDX: LDX<MODE>(source); break;
+		case Mnemonic::LDY: LDY<MODE>(source); break;
+		case Mnemonic::LSR: LSR<MODE>(source); break;
+		case Mnemonic::LSR_ACC: LSR_ACC(source); break;
+		case Mnemonic::NOP: NOP(source); break;
+		case Mnemonic::ORA: ORA<MODE>(source); break;
+		case Mnemonic::PHA: PHA(source); break;
+		case Mnemonic::PHP: PHP(source); break;
+		case Mnemonic::PLA: PLA(source); break;
+		case Mnemonic::PLP: PLP(source); break;
+		case Mnemonic::ROL: ROL<MODE>(source); break;
+		case Mnemonic::ROL_ACC: ROL_ACC(source); break;
+		case Mnemonic::ROR: ROR<MODE>(source); break;
+		case Mnemonic::ROR_ACC: ROR_ACC(source); break;
+		case Mnemonic::RTI: RTI(source); break;
+		case Mnemonic::RTS: RTS(source); break;
+		case Mnemonic::SBC: SBC<VARIANT,MODE>(source); break;
+		case Mnemonic::SEC: SEC(source); break;
+		case Mnemonic::SED: SED(source); break;
+		case Mnemonic::SEI: SEI(source); break;
+		case Mnemonic::STA: STA<MODE>(source); break;
+		case Mnemonic::STX: STX<MODE>(source); break;
+		case Mnemonic::STY: STY<MODE>(source); break;
+		case Mnemonic::TAX: TAX(source); break;
+		case Mnemonic::TAY: TAY(source); break;
+		case Mnemonic::TSX: TSX(source); break;
+		case Mnemonic::TXA: TXA(source); break;
+		case Mnemonic::TXS: TXS(source); break;
+		case Mnemonic::TYA: TYA(source); break;
+		case Mnemonic::BIT_IMM: BIT_IMM(source); break;
+		case Mnemonic::BRA: BRA(source); break;
+		case Mnemonic::DEC_ACC: DEC_ACC(source); break;
+		case Mnemonic::INC_ACC: INC_ACC(source); break;
+		case Mnemonic::PHX: PHX(source); break;
+		case Mnemonic::PHY: PHY(source); break;
+		case Mnemonic::PLX: PLX(source); break;
+		case Mnemonic::PLY: PLY(source); break;
+		case Mnemonic::STZ: STZ<MODE>(source); break;
+		case Mnemonic::TRB: TRB<MODE>(source); break;
+		case Mnemonic::TSB: TSB<MODE>(source); break;
+		case Mnemonic::JAM: JAM(source); break;
+		case Mnemonic::ILLEGAL: ILLEGAL(source); break;
+	}
+}
+
+template<Variant VARIANT,Mnemonic OPERATION,AddrMode MODE>
+void CPU::Op(CPU& cpu)
+{
+	cpu.operate<VARIANT,OPERATION,MODE>(cpu.resolve<VARIANT,MODE,addsPageCrossCycle(VARIANT,OPERATION,MODE)>());
+}
+
+template<Variant VARIANT,std::size_t... OPCODE>
+constexpr std::array<CPU::HANDLER,256> CPU::makeHandlerTable(std::index_sequence<OPCODE...>)
+{
+	return {{ &CPU::Op<VARIANT,opcodeTable(VARIANT)[OPCODE].operation,opcodeTable(VARIANT)[OPCODE].addr>... }};
+}
+
+const std::array<CPU::HANDLER,256> CPU::HANDLERS[VARIANT_COUNT] =
+{
+	CPU::makeHandlerTable<Variant::NMOS>(std::make_index_sequence<256>()),
+	CPU::makeHandlerTable<Variant::RP2A03>(std::make_index_sequence<256>()),
+	CPU::makeHandlerTable<Variant::CMOS>(std::make_index_sequence<256>())
 };
 
+template<Variant VARIANT,AddrMode MODE,bool PAGE_CROSS_CYCLE>
+ADDRESS CPU::resolveDecoded(ADDRESS operand)
+{
+	switch(MODE)
+	{
+		case AddrMode::ACC: return A;
+		case AddrMode::IMM: return operand; // address of the immediate byte
+		case AddrMode::ABS: return operand;
+		case AddrMode::ZER: return operand;
+		case AddrMode::ZEX: return (operand + X) % 256;
+		case AddrMode::ZEY: return (operand + Y) % 256;
+		case AddrMode::ABX: return indexed<PAGE_CROSS_CYCLE>(operand,X);
+		case AddrMode::ABY: return indexed<PAGE_CROSS_CYCLE>(operand,Y);
+		case AddrMode::IMP: return 0;
+		case AddrMode::REL: return operand; // branch target
+		case AddrMode::INX: return readPointer(operand + X);
+		case AddrMode::INY: return indexed<PAGE_CROSS_CYCLE>(readPointer(operand),Y);
+		case AddrMode::ABI: { uint16_t effLower = read(operand),
+							  effHigher = read(hasIndirectJumpBug(VARIANT) ? (operand & 0xFF00) + ((operand + 1) & 0x00FF) : (ADDRESS)(operand + 1));
+							  return effLower + 0x100 * effHigher; }
+		case AddrMode::ZPI: return readPointer(operand);
+		case AddrMode::AIX: { ADDRESS pointer = operand + X;
+							  return read(pointer) + (read((ADDRESS)(pointer + 1)) << 8); }
+	}
+	return 0;
+}
+
+template<Variant VARIANT,Mnemonic OPERATION,AddrMode MODE>
+void CPU::DecodedOp(CPU& cpu,ADDRESS operand)
+{
+	cpu.operate<VARIANT,OPERATION,MODE>(cpu.resolveDecoded<VARIANT,MODE,addsPageCrossCycle(VARIANT,OPERATION,MODE)>(operand));
+}
 
+template<Variant VARIANT,std::size_t... OPCODE>
+constexpr std::array<CPU::DECODED_HANDLER,256> CPU::makeDecodedTable(std::index_sequence<OPCODE...>)
+{
+	return {{ &CPU::DecodedOp<VARIANT,opcodeTable(VARIANT)[OPCODE].operation,opcodeTable(VARIANT)[OPCODE].addr>... }};
+}
+
+const std::array<CPU::DECODED_HANDLER,256> CPU::DECODED_HANDLERS[VARIANT_COUNT] =
+{
+	CPU::makeDecodedTable<Variant::NMOS>(std::make_index_sequence<256>()),
+	CPU::makeDecodedTable<Variant::RP2A03>(std::make_index_sequence<256>()),
+	CPU::makeDecodedTable<Variant::CMOS>(std::make_index_sequence<256>())
+};
 
 void CPU::reset()
 {
@@ -688,47 +219,751 @@ void CPU::reset()
 
 void CPU::push(uint8_t value)
 {
-    memory.writeToMemory(0x0100 + SP,value);
+    writeLow(0x0100 + SP,value);
     if(SP == 0x00) SP = 0xFF;
     else SP--;
 }
 
 uint8_t CPU::pop()
 {
-    if(SP = 0xFF) SP == 0x00;
+    if(SP == 0xFF) SP = 0x00;
     else SP++;
-    return memory.readFromMemory(0x0100 + SP);
+    return readLow(0x0100 + SP);
+}
+
+void CPU::setProgramCounter(uint16_t address)
+{
+	programCounter = address;
+}
+
+void CPU::moveProgramCounter(uint8_t offset)
+{
+	programCounter += offset;
+}
+
+void CPU::UpdateCurrentCycle(std::uint8_t offset)
+{
+	currentCycle += offset;
+}
+
+ADDRESS CPU::getProgramCounter() const
+{
+	return programCounter;
+}
+
+Variant CPU::getVariant() const
+{
+	return variant;
+}
+
+ADDRESS CPU::getStackPointerAddress() const
+{
+	return 0x0100 + SP;
+}
+
+uint64_t CPU::getCycleIndex() const
+{
+	return currentCycle;
+}
+
+void CPU::syncPPU()
+{
+	uint64_t targetDot = currentCycle * 3;
+	while(ppuDot < targetDot)
+	{
+		ppu.tick();
+		ppuDot++;
+	}
+}
+
+Scheduler& CPU::getScheduler()
+{
+	return scheduler;
+}
+
+Bus& CPU::getBus()
+{
+	return bus;
+}
+
+void CPU::saveState(STATE& state)
+{
+	syncPPU();
+
+	state.A = A;
+	state.X = X;
+	state.Y = Y;
+	state.SP = SP;
+	state.P = status();
+	state.programCounter = programCounter;
+	state.currentCycle = currentCycle;
+	state.ppuDot = ppuDot;
+	state.nextVBlankDot = nextVBlankDot;
+	state.irqPending = irqPending;
+	state.halted = halted;
+	state.haltReason = haltReason;
+	state.scheduler = scheduler;
+}
+
+void CPU::loadState(const STATE& state)
+{
+	A = state.A;
+	X = state.X;
+	Y = state.Y;
+	SP = state.SP;
+	setStatus(state.P);
+	programCounter = state.programCounter;
+	currentCycle = state.currentCycle;
+	ppuDot = state.ppuDot;
+	nextVBlankDot = state.nextVBlankDot;
+	irqPending = state.irqPending;
+	halted = state.halted;
+	haltReason = state.haltReason;
+	// Only timestamps are taken from the saved scheduler, handlers stay the ones of this machine
+	for(int i = 0;i < Scheduler::EVENT_COUNT;i++)
+	{
+		Scheduler::EVENT event = static_cast<Scheduler::EVENT>(i);
+		if(state.scheduler.isScheduled(event))
+			scheduler.schedule(event,state.scheduler.getEventCycle(event));
+		else
+			scheduler.cancel(event);
+	}
+}
+
+void CPU::interrupt(ADDRESS vectorLow,ADDRESS vectorHigh)
+{
+	push((programCounter >> 8) & 0xFF);
+	push(programCounter & 0xFF);
+	push(status() | UNUSED_FLAG); // break flag stays clear for hardware interrupts
+
+	P |= INTERRUPT_DISABLE_FLAG;
+	if(clearsDecimalOnInterrupt(variant)) P &= ~DECIMAL_FLAG;
+	programCounter = (read(vectorHigh) << 8) + read(vectorLow);
+	currentCycle += 7;
+
+	if(profiler) profiler->interrupt(programCounter,7); // handler shows up as its own frame until RTI
+}
+
+void CPU::onVBlank(void* context,uint64_t cycle)
+{
+	CPU& cpu = *static_cast<CPU*>(context);
+	cpu.syncPPU(); // PPU sets its vblank flag here and schedules Scheduler::NMI when enabled
+	cpu.nextVBlankDot += PPU_DOTS_PER_FRAME;
+	cpu.scheduler.schedule(Scheduler::PPU_VBLANK,(cpu.nextVBlankDot + 2) / 3);
+}
+
+void CPU::onNMI(void* context,uint64_t cycle)
+{
+	CPU& cpu = *static_cast<CPU*>(context);
+	cpu.interrupt(NMIVECTOR_L,NMIVECTOR_H);
+}
+
+void CPU::onIRQ(void* context,uint64_t cycle)
+{
+	CPU& cpu = *static_cast<CPU*>(context);
+	if(cpu.P & INTERRUPT_DISABLE_FLAG)
+	{
+		cpu.irqPending = true; // taken by pollPendingIRQ() once the flag is cleared
+		return;
+	}
+	cpu.irqPending = false;
+	cpu.interrupt(IRQVECTOR_L,IRQVECTOR_H);
+}
+
+void CPU::invalidateCode(uint8_t page)
+{
+	if(page == idleLoop.head >> 8 || page == (ADDRESS)(idleLoop.tail - 1) >> 8) idleLoop.checked = false; // body may have changed
+	if(!blockCache) return;
+	blockCache->pendingPages[page >> 6] |= 1ULL << (page & 63);
+	blockCache->pending = true;
+	breakBlock = true; // running block may be the one that was overwritten
+}
+
+void CPU::setLockstep(bool enabled)
+{
+	lockstep = enabled;
+}
+
+void CPU::setProfiler(Profiler* profiler)
+{
+	this->profiler = profiler;
+}
+
+void CPU::setTracer(Tracer* tracer)
+{
+	this->tracer = tracer;
+}
+
+void CPU::setDebugger(Debugger* debugger)
+{
+	this->debugger = debugger;
+}
+
+void CPU::setCoverage(Coverage* coverage)
+{
+	this->coverage = coverage;
+}
+
+void CPU::setIdleLoopSkip(bool enabled)
+{
+	idleLoop.enabled = enabled;
+}
+
+uint64_t CPU::getIdleCycles() const
+{
+	return idleLoop.skippedCycles;
+}
+
+void CPU::loopBack(ADDRESS tail)
+{
+	IDLE_LOOP& loop = idleLoop;
+	ADDRESS head = programCounter;
+	uint64_t registers = A | (X << 8) | (Y << 16) | ((uint64_t)SP << 24) | ((uint64_t)P << 32) | ((uint64_t)nz << 40);
+	uint32_t dispatches = scheduler.getDispatchCount();
+
+	if(head != loop.head || tail != loop.tail)
+	{
+		loop.head = head;
+		loop.tail = tail;
+		loop.checked = false;
+	}
+	else if(registers == loop.registers && dispatches == loop.dispatches && !loop.volatileRead)
+	{
+		if(!loop.checked || loop.checkedDispatches != dispatches) // most loops never get here since an iteration changes a register
+		{
+			loop.readOnly = isReadOnlyLoop(head,tail);
+			loop.checked = true;
+			loop.checkedDispatches = dispatches;
+		}
+
+		// Instructions of skipped iterations all start before the limit, like they would when executed
+		uint64_t limit = std::min(loop.endCycle,scheduler.nextEventCycle());
+		uint64_t length = currentCycle - loop.cycle;
+		if(loop.readOnly && length && limit > currentCycle)
+		{
+			uint64_t skipped = (limit - currentCycle) / length * length;
+			currentCycle += skipped;
+			loop.skippedCycles += skipped;
+		}
+	}
+
+	// Next iteration starts here
+	loop.registers = registers;
+	loop.cycle = currentCycle;
+	loop.dispatches = dispatches;
+	loop.volatileRead = false;
+}
+
+bool CPU::isReadOnlyLoop(ADDRESS head,ADDRESS tail) const
+{
+	static const int MAX_LOOP_LENGTH = 16; // polling loops are a few instructions
+
+	ADDRESS pc = head;
+	for(int i = 0;i < MAX_LOOP_LENGTH && pc != tail;i++)
+	{
+		const BYTE* code = bus.getPage(pc).read;
+		if(!code) return false;
+		const OPCODE& info = opcodeTable(variant)[code[pc & 0xFF]];
+		switch(info.operation)
+		{
+			case Mnemonic::STA: case Mnemonic::STX: case Mnemonic::STY: case Mnemonic::STZ:
+			case Mnemonic::ASL: case Mnemonic::LSR: case Mnemonic::ROL: case Mnemonic::ROR:
+			case Mnemonic::INC: case Mnemonic::DEC: case Mnemonic::TRB: case Mnemonic::TSB:
+			case Mnemonic::PHA: case Mnemonic::PHP: case Mnemonic::PLA: case Mnemonic::PLP:
+			case Mnemonic::PHX: case Mnemonic::PHY: case Mnemonic::PLX: case Mnemonic::PLY:
+			case Mnemonic::JSR: case Mnemonic::RTS: case Mnemonic::RTI: case Mnemonic::BRK:
+			case Mnemonic::JAM: case Mnemonic::ILLEGAL:
+				return false;
+			case Mnemonic::JMP:
+				if(info.addr != AddrMode::ABS) return false;
+				break;
+			default:
+				break; // reads memory at most
+		}
+		pc += 1 + operandLength(info.addr);
+	}
+	return pc == tail; // body decodes into whole instructions up to the jump back
+}
+
+void CPU::flushInvalidatedBlocks()
+{
+	BLOCK_CACHE& cache = *blockCache;
+
+	if(cache.mappingEpoch != bus.getMappingEpoch()) // bank switch or remap, nothing decoded is trusted
+	{
+		flushAllBlocks();
+		return;
+	}
+
+	for(int page = 0;page < 256;page++)
+	{
+		if(!(cache.pendingPages[page >> 6] & (1ULL << (page & 63)))) continue;
+		for(ADDRESS start : cache.pageBlocks[page])
+			cache.blocks.erase(start);
+		cache.pageBlocks[page].clear();
+		codePages[page >> 6] &= ~(1ULL << (page & 63));
+	}
+
+	for(int i = 0;i < 4;i++)
+		cache.pendingPages[i] = 0;
+	cache.pending = false;
+}
+
+void CPU::flushAllBlocks()
+{
+	BLOCK_CACHE& cache = *blockCache;
+
+	cache.blocks.clear();
+	for(int page = 0;page < 256;page++)
+		cache.pageBlocks[page].clear();
+	for(int i = 0;i < 4;i++)
+		codePages[i] = cache.pendingPages[i] = 0;
+	cache.mappingEpoch = bus.getMappingEpoch();
+	cache.pending = false;
+
+	if(jit) jit->reset(); // native code of single invalidated blocks is only reclaimed here
+}
+
+CPU::BLOCK* CPU::findBlock(ADDRESS address)
+{
+	BLOCK_CACHE& cache = *blockCache;
+
+	auto found = cache.blocks.find(address);
+	if(found != cache.blocks.end()) return &found->second;
+
+	static const int MAX_BLOCK_LENGTH = 32;
+
+	BLOCK block;
+	block.start = address;
+	block.cycles = 0;
+
+	ADDRESS pc = address;
+	for(int i = 0;i < MAX_BLOCK_LENGTH;i++)
+	{
+		// Decode only from host memory, MMIO reads would have side effects
+		const BYTE* code = bus.getPage(pc).read;
+		if(!code) break;
+		uint8_t opcode = code[pc & 0xFF];
+		const OPCODE& info = opcodeTable(variant)[opcode];
+
+		uint8_t length = operandLength(info.addr);
+		if(length && (!bus.getPage(pc + 1).read || !bus.getPage(pc + length).read)) break;
+		const BYTE* operandPage = bus.getPage(pc + length).read;
+
+		ADDRESS operand = 0;
+		ADDRESS nextPC = pc + 1 + length;
+		if(length == 1)
+			operand = bus.getPage(pc + 1).read[(pc + 1) & 0xFF];
+		else if(length == 2)
+			operand = bus.getPage(pc + 1).read[(pc + 1) & 0xFF] + (operandPage[(pc + 2) & 0xFF] << 8);
+
+		if(info.addr == AddrMode::IMM)
+			operand = pc + 1;
+		else if(info.addr == AddrMode::REL)
+			operand = nextPC + (int8_t)operand;
+
+		block.ops.push_back({ DECODED_HANDLERS[static_cast<uint8_t>(variant)][opcode],operand,nextPC,info.cycles,opcode });
+		block.lastStart = block.cycles;
+		block.cycles += info.cycles + addsPageCrossCycle(variant,info.operation,info.addr); // branches only end a block, their extra cycles come after lastStart
+		if(addsDecimalCycle(variant) && (info.operation == Mnemonic::ADC || info.operation == Mnemonic::SBC)) block.cycles++; // in case D is set
+		pc = nextPC;
+
+		if(changesControlFlow(info.operation)) break;
+	}
+
+	if(block.ops.empty()) return nullptr;
+	block.end = pc;
+
+	// Every page the block was decoded from invalidates it when written
+	for(int page = block.start >> 8;;page = (page + 1) & 0xFF)
+	{
+		cache.pageBlocks[page].push_back(block.start);
+		codePages[page >> 6] |= 1ULL << (page & 63);
+		if(page == ((block.end - 1) & 0xFFFF) >> 8) break;
+	}
+
+	return &(cache.blocks[address] = std::move(block));
+}
+
+template<Variant VARIANT,typename DEBUG,bool COVERED>
+bool CPU::runBlock(uint64_t endCycle,DEBUG debug)
+{
+	if(blockCache->pending || blockCache->mappingEpoch != bus.getMappingEpoch())
+		flushInvalidatedBlocks();
+	if(jit && jit->isFull())
+		flushAllBlocks();
+
+	BLOCK* block = findBlock(programCounter);
+	if(!block) return false;
+
+	// Every instruction of the block has to start before the budget ends and the next event is due,
+	// exactly like stepping would, otherwise step it one instruction at a time
+	uint64_t lastStart = currentCycle + block->lastStart;
+	if(lastStart >= endCycle || lastStart >= scheduler.nextEventCycle()) return false;
+	if(debug.breaksInside(block->start,block->end)) return false;
+
+	breakBlock = false;
+	size_t index = jit ? runNative(*block) : 0;
+	for(;index < block->ops.size() && !breakBlock;index++) // code was written, MMIO was touched or an IRQ got unmasked
+	{
+		const MICRO_OP& op = block->ops[index];
+		currentOpCode = op.opcode;
+		programCounter = op.nextPC;
+		currentCycle += op.cycles;
+		op.handler(*this,op.operand);
+	}
+
+	if(COVERED && index == block->ops.size() && Coverage::isEdge(VARIANT,block->ops.back().opcode)) // blocks only end on control flow
+	{
+		const MICRO_OP& last = block->ops.back();
+		coverage->edge(last.nextPC - 1 - operandLength(opcodeTable(VARIANT)[last.opcode].addr),programCounter);
+	}
+	return true;
+}
+
+size_t CPU::runNative(BLOCK& block)
+{
+	if(!block.native.code)
+	{
+		if(block.hits > JIT_THRESHOLD || ++block.hits <= JIT_THRESHOLD) return 0; // cold, or could not be translated
+
+		std::vector<JIT::INSTRUCTION> instructions;
+		for(const MICRO_OP& op : block.ops)
+			instructions.push_back({ op.opcode,op.operand,op.nextPC });
+		block.native = jit->translate(instructions.data(),instructions.size(),bus);
+		if(!block.native.code) return 0;
+	}
+
+	JIT::CONTEXT context = { A,X,Y,SP,P,nz,programCounter,currentCycle };
+	if(lockstep) return runLockstep(block,context);
+
+	uint32_t exit = block.native.code(&context);
+	if(exit == JIT::EXIT_DECLINED) return 0;
+
+	loadContext(context);
+	if(exit & JIT::EXIT_CODE_WRITE)
+	{
+		size_t ran = exit >> 16; // the store that hit code was the last instruction to run
+		currentOpCode = block.ops[ran - 1].opcode;
+		invalidateCode(exit & 0xFF); // sets breakBlock
+		return ran;
+	}
+	const MICRO_OP& last = block.ops[block.native.count - 1];
+	currentOpCode = last.opcode;
+	if(programCounter != last.nextPC) jumped(last.nextPC); // native branch or JMP was taken
+	return block.native.count;
+}
+
+size_t CPU::runLockstep(BLOCK& block,JIT::CONTEXT& context)
+{
+	// Pages the native code may write are put back, so the interpreter starts from the same memory
+	std::vector<BYTE> before,after;
+	std::vector<uint8_t> pages;
+	for(int page = 0;page < 256;page++)
+		if(block.native.writePages[page >> 6] & (1ULL << (page & 63)))
+		{
+			const BYTE* memory = bus.getPage(page << 8).write;
+			pages.push_back(page);
+			before.insert(before.end(),memory,memory + 256);
+		}
+
+	uint32_t exit = block.native.code(&context);
+	if(exit == JIT::EXIT_DECLINED) return 0;
+
+	for(size_t i = 0;i < pages.size();i++)
+	{
+		BYTE* memory = bus.getPage(pages[i] << 8).write;
+		after.insert(after.end(),memory,memory + 256);
+		std::copy(before.begin() + i * 256,before.begin() + (i + 1) * 256,memory);
+	}
+
+	// Reference run of the same ops through the interpreter
+	size_t index = 0;
+	for(;index < block.native.count && !breakBlock;index++)
+	{
+		const MICRO_OP& op = block.ops[index];
+		currentOpCode = op.opcode;
+		programCounter = op.nextPC;
+		currentCycle += op.cycles;
+		op.handler(*this,op.operand);
+	}
+
+	bool same = context.A == A && context.X == X && context.Y == Y && context.SP == SP &&
+				context.P == P && context.nz == nz &&
+				context.programCounter == programCounter && context.currentCycle == currentCycle;
+	for(size_t i = 0;i < pages.size() && same;i++)
+		same = std::equal(after.begin() + i * 256,after.begin() + (i + 1) * 256,bus.getPage(pages[i] << 8).write);
+
+	if(!same)
+	{
+		lockstepMismatch = block.start; // for the host to report
+		block.native = JIT::TRANSLATION(); // interpreter result is kept, block is never translated again
+		halted = true;
+		haltReason = STOP_REASON::LOCKSTEP_MISMATCH;
+		breakBlock = true;
+	}
+	return index;
+}
+
+void CPU::loadContext(const JIT::CONTEXT& context)
+{
+	A = context.A;
+	X = context.X;
+	Y = context.Y;
+	SP = context.SP;
+	P = context.P;
+	nz = context.nz;
+	programCounter = context.programCounter;
+	currentCycle = context.currentCycle;
+}
+
+template<CPU::DISPATCH BACKEND,Variant VARIANT>
+void CPU::step()
+{
+	currentOpCode = read(programCounter++); // Fetch
+
+	if(BACKEND != DISPATCH::JUMP_TABLE)
+		executeSwitch<VARIANT>(); // Decode and execute in one step
+	else
+	{
+		currentCycle += opcodeTable(VARIANT)[currentOpCode].cycles;
+		execute<VARIANT>(); // Execute
+	}
+}
+
+template<CPU::DISPATCH BACKEND,Variant VARIANT>
+void CPU::instrumentedStep()
+{
+	ADDRESS pc = programCounter;
+	uint64_t startCycle = currentCycle;
+
+	if(tracer)
+	{
+		Tracer::RECORD& entry = tracer->next(); // written in place, no copy of a half written record
+		entry.cycle = currentCycle;
+		entry.pc = pc;
+		// Bytes are peeked from host memory, reading MMIO here would have side effects
+		const Bus::PAGE& page = bus.getPage(pc);
+		if(page.read && (pc & 0xFF) <= 0xFD)
+			memcpy(entry.bytes,page.read + (pc & 0xFF),3);
+		else
+			for(int i = 0;i < 3;i++)
+			{
+				const Bus::PAGE& bytePage = bus.getPage(pc + i);
+				entry.bytes[i] = bytePage.read ? bytePage.read[(pc + i) & 0xFF] : 0x00;
+			}
+		uint8_t length = operandLength(opcodeTable(VARIANT)[entry.bytes[0]].addr);
+		if(length < 2) entry.bytes[2] = 0x00;
+		if(length < 1) entry.bytes[1] = 0x00;
+		entry.A = A;
+		entry.X = X;
+		entry.Y = Y;
+		entry.SP = SP;
+		entry.P = status() | UNUSED_FLAG;
+		tracer->commit();
+	}
+
+	step<BACKEND,VARIANT>();
+
+	if(coverage && Coverage::isEdge(VARIANT,currentOpCode))
+		coverage->edge(pc,programCounter);
+
+	if(profiler)
+	{
+		profiler->record(pc,currentOpCode,currentCycle - startCycle);
+		switch(currentOpCode)
+		{
+			case 0x20: // JSR
+			case 0x00: // BRK
+				profiler->call(programCounter);
+				break;
+			case 0x60: // RTS
+			case 0x40: // RTI
+				profiler->ret();
+				break;
+		}
+	}
 }
 
 void CPU::tick()
 {
-	currentOpCode = memory.readFromMemory(programCounter++); // Fetch
+	if(currentCycle >= scheduler.nextEventCycle())
+		scheduler.dispatch(currentCycle);
+
+	switch(variant)
+	{
+		case Variant::NMOS: tickVariant<Variant::NMOS>(); break;
+		case Variant::RP2A03: tickVariant<Variant::RP2A03>(); break;
+		case Variant::CMOS: tickVariant<Variant::CMOS>(); break;
+	}
+}
+
+template<Variant VARIANT>
+void CPU::tickVariant()
+{
+	if(profiler || tracer || coverage)
+	{
+		if(dispatch == DISPATCH::JUMP_TABLE)
+			instrumentedStep<DISPATCH::JUMP_TABLE,VARIANT>();
+		else
+			instrumentedStep<DISPATCH::SWITCH,VARIANT>();
+	}
+	else if(dispatch == DISPATCH::JUMP_TABLE)
+		step<DISPATCH::JUMP_TABLE,VARIANT>();
+	else
+		step<DISPATCH::SWITCH,VARIANT>(); // single instruction, a block would run past it
+}
+
+template<CPU::DISPATCH BACKEND,Variant VARIANT,typename DEBUG,bool INSTRUMENTED,bool COVERED>
+CPU::STOP_REASON CPU::runLoop(uint64_t endCycle,DEBUG debug)
+{
+	STOP_REASON reason = STOP_REASON::BUDGET_EXHAUSTED;
+	halted = false;
+	debug.begin();
+	// Host may have changed memory since the last run, loops are looked for from scratch.
+	// Skipping would hide iterations from profiler, tracer, coverage and lockstep
+	idleLoop.head = idleLoop.tail = 0;
+	idleLoop.endCycle = idleLoop.enabled && !INSTRUMENTED && !COVERED && !lockstep ? endCycle : 0;
+
+	while(currentCycle < endCycle)
+	{
+		// Instructions run back to back until the next scheduled event is due
+		if(currentCycle >= scheduler.nextEventCycle())
+			scheduler.dispatch(currentCycle);
+
+		if(debug.breaksAt(programCounter))
+		{
+			reason = STOP_REASON::BREAKPOINT;
+			break;
+		}
+
+		if(INSTRUMENTED)
+			instrumentedStep<BACKEND,VARIANT>(); // records coverage itself
+		else if(BACKEND != DISPATCH::BLOCK_CACHE || !runBlock<VARIANT,DEBUG,COVERED>(endCycle,debug))
+		{
+			ADDRESS pc = programCounter;
+			step<BACKEND,VARIANT>();
+			if(COVERED && Coverage::isEdge(VARIANT,currentOpCode))
+				coverage->edge(pc,programCounter);
+		}
+
+		if(halted)
+		{
+			reason = haltReason;
+			break;
+		}
+
+		if(debug.watchHit()) // watched pages go through MMIO, so a block ends right after the access
+		{
+			reason = STOP_REASON::WATCHPOINT;
+			break;
+		}
+	}
+
+	idleLoop.endCycle = 0; // tick() never skips
+	syncPPU(); // host sees a PPU that matches currentCycle
+
+	return reason;
+}
+
+template<typename DEBUG>
+CPU::STOP_REASON CPU::runVariant(uint64_t endCycle,DEBUG debug)
+{
+	switch(variant)
+	{
+		case Variant::RP2A03: return runPolicy<Variant::RP2A03>(endCycle,debug);
+		case Variant::CMOS: return runPolicy<Variant::CMOS>(endCycle,debug);
+		default: return runPolicy<Variant::NMOS>(endCycle,debug);
+	}
+}
+
+template<Variant VARIANT,typename DEBUG>
+CPU::STOP_REASON CPU::runPolicy(uint64_t endCycle,DEBUG debug)
+{
+	if(profiler || tracer) // one instruction at a time so each one is seen on its own
+		return runLoop<DISPATCH::SWITCH,VARIANT,DEBUG,true>(endCycle,debug);
 
-	ppu.tick();
-	ppu.tick();
-	ppu.tick();	
+	if(coverage)
+		return runBackend<VARIANT,DEBUG,true>(endCycle,debug);
 
-	currentInstruction = table[currentOpCode]; // Decode 
+	return runBackend<VARIANT,DEBUG,false>(endCycle,debug);
+}
 
-	ppu.tick();
-	ppu.tick();
-	ppu.tick();	
+template<Variant VARIANT,typename DEBUG,bool COVERED>
+CPU::STOP_REASON CPU::runBackend(uint64_t endCycle,DEBUG debug)
+{
+	if(dispatch == DISPATCH::BLOCK_CACHE || dispatch == DISPATCH::JIT) // JIT only changes how a block runs
+		return runLoop<DISPATCH::BLOCK_CACHE,VARIANT,DEBUG,false,COVERED>(endCycle,debug);
 
-	currentCycle += currentInstruction.cycles;
+	if(dispatch == DISPATCH::SWITCH)
+		return runLoop<DISPATCH::SWITCH,VARIANT,DEBUG,false,COVERED>(endCycle,debug);
 
-	execute(); // Execute
+	return runLoop<DISPATCH::JUMP_TABLE,VARIANT,DEBUG,false,COVERED>(endCycle,debug);
 }
 
+CPU::STOP_REASON CPU::runDispatch(uint64_t endCycle,bool checkBreakpoint,ADDRESS breakpoint)
+{
+	// Debug policy, variant and backend are resolved once here, not for every instruction
+	if(debugger)
+		return runVariant(endCycle,FULL_DEBUG{ debugger,checkBreakpoint,breakpoint });
+
+	if(checkBreakpoint)
+		return runVariant(endCycle,ONE_BREAKPOINT{ breakpoint });
+
+	return runVariant(endCycle,NO_DEBUG{});
+}
+
+CPU::STOP_REASON CPU::run(uint64_t cycles)
+{
+	uint64_t endCycle = cycles > UINT64_MAX - currentCycle ? UINT64_MAX : currentCycle + cycles;
+	return runDispatch(endCycle,false,0);
+}
 
+CPU::STOP_REASON CPU::runFrames(uint32_t frames)
+{
+	// Frames are counted in PPU dots so fractional CPU cycles per frame do not drift
+	uint64_t endDot = currentCycle * 3 + (uint64_t)frames * PPU_DOTS_PER_FRAME;
+	return runDispatch((endDot + 2) / 3,false,0);
+}
+
+CPU::STOP_REASON CPU::runUntil(ADDRESS breakpoint,uint64_t cycles)
+{
+	uint64_t endCycle = cycles > UINT64_MAX - currentCycle ? UINT64_MAX : currentCycle + cycles;
+	return runDispatch(endCycle,true,breakpoint);
+}
+
+template<Variant VARIANT>
 void CPU::execute()
 {
-	ppu.tick();
-	ppu.tick();
-	ppu.tick();
-	
-	(this->*currentInstruction.operation)((this->*currentInstruction.addr)());
+	HANDLERS[static_cast<uint8_t>(VARIANT)][currentOpCode](*this); // Decode and execute
 }
 
+// Every case is generated from the OPCODE table of VARIANT so both backends share one table
+#define OPCODE_INFO(N) opcodeTable(VARIANT)[N]
+#define OPCODE_CASE(N) case N: currentCycle += OPCODE_INFO(N).cycles; \
+	operate<VARIANT,OPCODE_INFO(N).operation,OPCODE_INFO(N).addr>(resolve<VARIANT,OPCODE_INFO(N).addr,addsPageCrossCycle(VARIANT,OPCODE_INFO(N).operation,OPCODE_INFO(N).addr)>()); return;
+#define OPCODE_ROW(H) \
+	OPCODE_CASE(0x##H##0) OPCODE_CASE(0x##H##1) OPCODE_CASE(0x##H##2) OPCODE_CASE(0x##H##3) \
+	OPCODE_CASE(0x##H##4) OPCODE_CASE(0x##H##5) OPCODE_CASE(0x##H##6) OPCODE_CASE(0x##H##7) \
+	OPCODE_CASE(0x##H##8) OPCODE_CASE(0x##H##9) OPCODE_CASE(0x##H##A) OPCODE_CASE(0x##H##B) \
+	OPCODE_CASE(0x##H##C) OPCODE_CASE(0x##H##D) OPCODE_CASE(0x##H##E) OPCODE_CASE(0x##H##F)
+
+template<Variant VARIANT>
+void CPU::executeSwitch()
+{
+	switch(currentOpCode)
+	{
+		OPCODE_ROW(0) OPCODE_ROW(1) OPCODE_ROW(2) OPCODE_ROW(3)
+		OPCODE_ROW(4) OPCODE_ROW(5) OPCODE_ROW(6) OPCODE_ROW(7)
+		OPCODE_ROW(8) OPCODE_ROW(9) OPCODE_ROW(A) OPCODE_ROW(B)
+		OPCODE_ROW(C) OPCODE_ROW(D) OPCODE_ROW(E) OPCODE_ROW(F)
+	}
+}
+
+#undef OPCODE_ROW
+#undef OPCODE_CASE
+#undef OPCODE_INFO
+
 std::ostream& operator<<(std::ostream &out,CPU &cpu)
 {
 	out << "REGISTERS: " << std::endl;
@@ -3,22 +3,45 @@
 
 #include "../Utils/handler.h"
 #include "../Bus/RAM.h"
+#include "../Bus/Bus.h"
 #include "../PPU/PPU.h"
-#include <functional>
-
-using std::function;
+#include "../Utils/Scheduler.h"
+#include "Opcodes.h"
+#include "JIT.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "Debugger.h"
+#include "Coverage.h"
+#include <utility>
+#include <memory>
+#include <vector>
+#include <unordered_map>
 
 /*  
 
     This is a solid emulation of 6502 Proccessor.
     
-    CPU EMULATION TYPE : Jump Table Based
+    CPU EMULATION TYPE : Jump Table Based or Switch Based (selected on construction)
 
     EXPLANATION :
-    Each addressing mode (ADDRESSING_MODE) and operation (OPEXEC) is a lambda function 
-    and they are forming INSTRUCTION struct with cycle count for each OPCODE
+    Each addressing mode (AddrMode) and operation (Mnemonic) is an inline member function.
+    OPCODES (Opcodes.h) pairs them with a cycle count for each OPCODE and
+    Op<OPERATION,MODE> instantiates one specialized handler for every pair.
     Since there is 256 OPCODE but 6502 using only 151 of them,remaining
-    OPCODEs are illegal and they literally do nothing (NOP)
+    OPCODEs are illegal
+
+    DISPATCH::JUMP_TABLE calls through HANDLERS[256] (kept as reference implementation)
+    DISPATCH::SWITCH uses a flat switch in which every OPCODE has its addressing mode
+    and operation inlined, so there is no indirect call per instruction
+    DISPATCH::BLOCK_CACHE decodes straight-line code once into MICRO_OPs with operands
+    already extracted and replays them, blocks are dropped when their page is written
+    DISPATCH::JIT is BLOCK_CACHE plus native code (JIT.h) for blocks that ran JIT_THRESHOLD times,
+    on hosts without a code generator it behaves like BLOCK_CACHE
+
+    VARIANT (selected on construction) : NMOS 6502, RP2A03 (NES) or CMOS 65C02, see Opcodes.h.
+    Handlers, the switch and the run loops are instantiated once per Variant, so decimal mode,
+    the JMP ($xxFF) page wrap and the OPCODE set are decided at compile time.
+    The RP2A03 core has no decimal mode check in ADC and SBC at all.
 
 */
 
@@ -32,7 +55,31 @@ using std::function;
 class CPU
 {
     public:
-        CPU(RAM& mem,PPU& ppu); 
+        enum class DISPATCH { JUMP_TABLE, SWITCH, BLOCK_CACHE, JIT };
+
+        enum class STOP_REASON { BUDGET_EXHAUSTED, BREAKPOINT, ILLEGAL_OPCODE, JAM, LOCKSTEP_MISMATCH, WATCHPOINT }; // why run() returned
+
+        struct STATE // everything of the CPU a save state needs, memory is saved through Bus pages
+        {
+            uint8_t A,X,Y,SP;
+            uint8_t P; // status byte as PHP pushes it, without B and bit 5
+            ADDRESS programCounter;
+            uint64_t currentCycle;
+            uint64_t ppuDot,nextVBlankDot;
+            bool irqPending,halted;
+            STOP_REASON haltReason;
+            Scheduler scheduler;
+        };
+
+        static const uint32_t PPU_DOTS_PER_FRAME = 341 * 262; // NTSC, 3 PPU dots per CPU cycle
+
+        static const uint32_t PPU_VBLANK_DOT = 241 * 341 + 1; // dot of the frame where vblank (and NMI) starts
+
+        CPU(Bus& bus,PPU& ppu,DISPATCH dispatch = DISPATCH::SWITCH,Variant variant = Variant::NMOS); // attach to an externally owned bus
+
+        CPU(RAM& mem,PPU& ppu,DISPATCH dispatch = DISPATCH::SWITCH,Variant variant = Variant::NMOS); // mem mapped flat over 64KB, not copied
+
+        CPU(const CPU&) = delete; // scheduler handlers point at this instance
 
         void setProgramCounter(uint16_t address);
 
@@ -42,580 +89,977 @@ class CPU
 
         ADDRESS getProgramCounter() const; 
 
+        Variant getVariant() const;
+
         ADDRESS getStackPointerAddress() const; // Stack pointer address from RAM
  
 
         uint64_t getCycleIndex() const; // current cycle index
+
+        void syncPPU(); // advance PPU to 3 * currentCycle dots
+
+        Scheduler& getScheduler(); // PPU/APU/mapper schedule NMI, IRQ and their own events here
+
+        Bus& getBus(); // map ROM, mirrors and MMIO registers here
+
+        void saveState(STATE& state); // syncs PPU first so PPU state matches currentCycle
+
+        void loadState(const STATE& state);
+
+        void invalidateCode(uint8_t page); // host changed memory behind the CPU, drop decoded blocks of page
+
+        void setLockstep(bool enabled); // JIT: interpret every native block again and compare, stops with LOCKSTEP_MISMATCH
+
+        ADDRESS getLockstepMismatch() const { return lockstepMismatch; } // start of the block that stopped a run with LOCKSTEP_MISMATCH
+
+        void setProfiler(Profiler* profiler); // nullptr detaches, profiler is owned by the host
+
+        void setTracer(Tracer* tracer); // nullptr detaches, tracer is owned by the host
+
+        void setDebugger(Debugger* debugger); // nullptr detaches, debugger is owned by the host and hooks the same Bus
+
+        void setCoverage(Coverage* coverage); // nullptr detaches, coverage map is owned by the host
+
+        void setIdleLoopSkip(bool enabled); // fast-forward spin loops to the next event in run(), off by default, see IDLE LOOPS
+
+        uint64_t getIdleCycles() const; // cycles fast-forwarded so far
         
         void tick();
 
+        STOP_REASON run(uint64_t cycles); // execute until at least cycles are spent
+
+        STOP_REASON runFrames(uint32_t frames); // execute for frames worth of cycles
+
+        STOP_REASON runUntil(ADDRESS breakpoint,uint64_t cycles = UINT64_MAX); // stop before executing breakpoint
+
         friend std::ostream& operator<<(std::ostream &out,CPU &cpu); // For logging stuff
 
+        friend class BatchCPU; // loads lane registers for instructions it has no kernel for
+
     private:
         using OPEXEC = void;
-        using OPEXEC_PTR = const std::function<CPU::OPEXEC (ADDRESS)> CPU::*;
-        using ADDRESSING_MODE =  const function<ADDRESS ()> CPU::*;
-        struct INSTRUCTION 
-        {
-            ADDRESSING_MODE addr;
-            OPEXEC_PTR operation;
-            uint8_t cycles;
-        };
+        using HANDLER = void (*)(CPU&);
 
         /*----------CORE REGISTERS------------*/
-        uint8_t A   = 0x00; // Accumulator
+        // Everything an instruction touches is packed into the first cache line of CPU,
+        // the second one starts with the next scheduled event, cold state comes after.
+        // Keep new members out of this line unless every instruction needs them.
+        alignas(64) uint8_t A = 0x00; // Accumulator
         uint8_t X   = 0x00; //
         uint8_t Y   = 0x00; // Index registers
         uint8_t SP  = 0xFF; // Stack Pointer is between 0xFF and 0x00
 
-        FLAG CARRY = 0,OVERFLOWBIT = 0,ZERO = 0,NEGATIVE = 0,BREAK = 0,INTERRUPT_DISABLE = 0,DECIMAL = 0; // Processor flags
+        uint8_t P = 0x00;   // Processor status, only C,I,D,V (N and Z see nz)
+        uint8_t currentOpCode = 0x00;
+        uint16_t nz = 0x01; // result N and Z are derived from, see FLAGS
 
-        static const ADDRESS IRQVECTOR_H = 0xFFFF;
-        static const ADDRESS IRQVECTOR_L = 0xFFFE;
-        static const ADDRESS RSTVECTOR_H = 0xFFFD;
-        static const ADDRESS RSTVECTOR_L = 0xFFFC;
-        static const ADDRESS NMIVECTOR_H = 0xFFFB;
-        static const ADDRESS NMIVECTOR_L = 0xFFFA;
-
-        /* PROGRAM COUNTER */
         ADDRESS programCounter = 0x0000;
 
-        /* CYCLE INDEX */
+        bool halted = false; // set by ILLEGAL and JAM, ends the current run
+        bool breakBlock = false; // leave the current block after this MICRO_OP
+
         uint64_t currentCycle = 0x0000000000000000;
 
-        uint8_t currentOpCode;
+        Bus& bus; // every access of the CPU goes through this page table, owned by the host
 
-        INSTRUCTION currentInstruction;
+        uint64_t codePages[4] = { 0,0,0,0 }; // bit per page holding decoded code, checked on every RAM write
 
-        RAM memory;
+        /* EVENTS (second cache line) */
+        alignas(64) Scheduler scheduler;
+
+        /* PPU CATCH-UP */
+        uint64_t ppuDot = 0; // PPU dots emulated so far, lags 3 * currentCycle until synced
+        uint64_t nextVBlankDot = PPU_VBLANK_DOT; // PPU must be synced by then
+
+        PPU& ppu; // owned by the host, CPU only drives it
+
+        bool irqPending = false; // IRQ arrived while INTERRUPT_DISABLE was set
+
+        /* COLD */
+        STOP_REASON haltReason = STOP_REASON::BUDGET_EXHAUSTED;
+
+        DISPATCH dispatch;
+        Variant variant;
+
+        std::unique_ptr<Bus> ownedBus; // only set when constructed from RAM
+
+        Profiler* profiler = nullptr;
+        Tracer* tracer = nullptr;
+        Debugger* debugger = nullptr;
+        Coverage* coverage = nullptr;
+
+        /* IDLE LOOPS */
+        // A loop polls memory while nothing can change it: its body [head,tail) only reads (RAM or stable MMIO),
+        // one full iteration left A,X,Y,SP,P and nz as they were and no event ran meanwhile. Every following
+        // iteration is the same one again, so whole iterations are skipped up to the next event or the end
+        // of run(). Loop heads are found by jumped(), which sees every taken branch and jump.
+        struct IDLE_LOOP
+        {
+            bool enabled = false;
+            uint64_t endCycle = 0; // skip no further, 0 outside run() and while instrumented
+            ADDRESS head = 0,tail = 0; // tail follows the jump back, 0,0 when there is no loop
+            bool checked = false,readOnly = false; // body decoded, found free of writes, stack and calls
+            uint32_t checkedDispatches = 0; // Scheduler::getDispatchCount() when checked, an event may have rewritten the body since
+            uint64_t registers = 0; // A,X,Y,SP,P and nz when the iteration started
+            uint64_t cycle = 0;
+            uint32_t dispatches = 0; // Scheduler::getDispatchCount() when the iteration started
+            bool volatileRead = false; // read an MMIO page that is not stable during the iteration
+            uint64_t skippedCycles = 0;
+        } idleLoop;
+
+        static const uint8_t CARRY_FLAG = 1 << CARRY_BIT;
+        static const uint8_t ZERO_FLAG = 1 << ZERO_BIT;
+        static const uint8_t INTERRUPT_DISABLE_FLAG = 1 << INTERRUPT_DISABLE_BIT;
+        static const uint8_t DECIMAL_FLAG = 1 << DECIMAL_MODE_BIT;
+        static const uint8_t BREAK_FLAG = 1 << BREAK_BIT;
+        static const uint8_t UNUSED_FLAG = 1 << UNUSED_BIT;
+        static const uint8_t OVERFLOW_FLAG = 1 << OVERFLOW_BIT;
+        static const uint8_t NEGATIVE_FLAG = 1 << NEGATIVE_BIT;
+
+        static const ADDRESS IRQVECTOR_H = 0xFFFF;
+        static const ADDRESS IRQVECTOR_L = 0xFFFE;
+        static const ADDRESS RSTVECTOR_H = 0xFFFD;
+        static const ADDRESS RSTVECTOR_L = 0xFFFC;
+        static const ADDRESS NMIVECTOR_H = 0xFFFB;
+        static const ADDRESS NMIVECTOR_L = 0xFFFA;
 
-        PPU ppu;
-        
         void reset(); // CPU to default state
 
+        void initialize(); // scheduler handlers and backend state, shared by constructors
+
         void push(uint8_t value); // Push value to stack
 
         uint8_t pop(); // Pop from stack 
 
-        INSTRUCTION table[256];
+        static const std::array<HANDLER,256> HANDLERS[VARIANT_COUNT]; // OPCODE tables expanded into handlers
 
+        template<Variant VARIANT>
         void execute();
 
-        /*------------------------OPERATIONS------------------------*/
-        const function<OPEXEC(ADDRESS)> ADC = [this](ADDRESS source)
-        {
-            uint8_t data = memory.readFromMemory(source);
-            unsigned int temp = data + A + (CARRY ? 1 : 0);
-            ZERO = !(temp & 0xFF);
+        template<Variant VARIANT>
+        void executeSwitch();
 
-            if(DECIMAL)
+        /*------------------------MEMORY ACCESS------------------------*/
+        BYTE read(ADDRESS address)
+        {
+            const Bus::PAGE& page = bus.getPage(address);
+            if(page.read) return page.read[address & 0xFF]; // RAM/ROM
+            if((address & 0xE000) == 0x2000) syncPPU(); // PPU registers see up to date PPU state
+            breakBlock = true; // handler may have scheduled an event
+            const Bus::MMIO& handler = bus.getMMIO(address);
+            if(!handler.stable) idleLoop.volatileRead = true;
+            return handler.read(handler.context,address);
+        }
+
+        void write(ADDRESS address,BYTE value)
+        {
+            const Bus::PAGE& page = bus.getPage(address);
+            if(page.write)
             {
-                if(((A & 0xF) + (data & 0xF) + (CARRY ? 1 : 0)) > 9) temp += 6;
-                NEGATIVE = temp & 0x80;
-                OVERFLOWBIT = !((A ^ data) & 0x80) && ((A ^ temp) & 0x80);
-                if(temp > 0x99) temp += 96;
-                CARRY = temp > 0x99; 
+                page.write[address & 0xFF] = value; // RAM
+                bus.markDirty(address);
+                if(codePages[address >> 14] & (1ULL << ((address >> 8) & 63))) invalidateCode(address >> 8); // self-modifying code
+                return;
             }
-            else
+            if((address & 0xE000) == 0x2000 || address == 0x4014) syncPPU(); // PPU registers and OAM DMA
+            breakBlock = true;
+            const Bus::MMIO& handler = bus.getMMIO(address);
+            if(handler.write) handler.write(handler.context,address,value);
+        }
+
+        // $0000-$01FF (zero page and stack) straight from host memory while the Bus maps it as plain RAM,
+        // no MMIO checks and constant dirty/code page bits. Otherwise (Debugger watchpoint, unusual host mapping) read()/write()
+        BYTE readLow(ADDRESS address)
+        {
+            if(BYTE* low = bus.getLowMemory()) return low[address];
+            return read(address);
+        }
+
+        void writeLow(ADDRESS address,BYTE value)
+        {
+            BYTE* low = bus.getLowMemory();
+            if(!low) return write(address,value);
+            low[address] = value;
+            bus.markDirty(address);
+            if(codePages[0] & (1ULL << (address >> 8))) invalidateCode(address >> 8); // code in zero page or on the stack
+        }
+
+        ADDRESS readPointer(uint8_t zero) // little endian pointer in zero page, the high byte of $FF comes from $00
+        {
+            if(BYTE* low = bus.getLowMemory()) return low[zero] | (low[(uint8_t)(zero + 1)] << 8);
+            return read(zero) | (read((uint8_t)(zero + 1)) << 8);
+        }
+
+        template<AddrMode MODE> // operand accessors, zero page modes can never reach past $00FF
+        BYTE load(ADDRESS address) { return isZeroPage(MODE) ? readLow(address) : read(address); }
+
+        template<AddrMode MODE>
+        void store(ADDRESS address,BYTE value) { if(isZeroPage(MODE)) writeLow(address,value); else write(address,value); }
+
+        /*------------------------IDLE LOOPS------------------------*/
+        void jumped(ADDRESS next) // a branch or jump set programCounter, next is the instruction after it
+        {
+            if(!idleLoop.endCycle) return;
+            if(programCounter < next) loopBack(next);
+            else if(programCounter >= idleLoop.tail) idleLoop.head = idleLoop.tail = 0; // left the loop, code outside may write
+        }
+
+        void loopBack(ADDRESS tail); // an iteration of [programCounter,tail) ended, fast-forward if it is idle
+
+        bool isReadOnlyLoop(ADDRESS head,ADDRESS tail) const;
+
+        /*------------------------INTERRUPTS------------------------*/
+        void interrupt(ADDRESS vectorLow,ADDRESS vectorHigh); // push PC and flags, jump through vector
+
+        void pollPendingIRQ()
+        {
+            if(irqPending && !(P & INTERRUPT_DISABLE_FLAG))
             {
-                NEGATIVE = temp & 0x80;
-                OVERFLOWBIT = !((A ^ data) & 0x80) && ((A ^ temp) & 0x80);
-                CARRY = temp > 0xFF;
+                scheduler.schedule(Scheduler::IRQ,currentCycle);
+                breakBlock = true;
             }
+        }
 
-            A = temp & 0xFF;
-        };
+        static void onVBlank(void* context,uint64_t cycle);
 
-        const function<OPEXEC(ADDRESS)> AND = [this](ADDRESS source)
+        static void onNMI(void* context,uint64_t cycle);
+
+        static void onIRQ(void* context,uint64_t cycle);
+
+        template<DISPATCH BACKEND,Variant VARIANT>
+        void step(); // fetch, decode and execute one instruction
+
+        template<DISPATCH BACKEND,Variant VARIANT>
+        void instrumentedStep(); // step() that reports to profiler and tracer
+
+        template<Variant VARIANT>
+        void tickVariant(); // tick() once the variant is known
+
+        /*------------------------DEBUG POLICIES------------------------*/
+        // runLoop() and runBlock() are instantiated once per policy (and Variant), with NO_DEBUG every check folds away
+        struct NO_DEBUG
         {
-            A = A | memory.readFromMemory(source);
-            ZERO = !A;
-            NEGATIVE = A & 0x80;
+            void begin() { }
+            bool breaksAt(ADDRESS pc) const { return false; }
+            bool breaksInside(ADDRESS start,ADDRESS end) const { return false; } // block [start,end) holds a breakpoint
+            bool watchHit() { return false; }
         };
 
-        const function<OPEXEC(ADDRESS)> ASL = [this](ADDRESS source)
+        struct ONE_BREAKPOINT // runUntil()
         {
-            uint8_t data = memory.readFromMemory(source);
-            CARRY = data & 0x80;
-            data <<= 1;
-            data &= 0xFF;
-            NEGATIVE = data & 0x80;
-            ZERO = !data;
-            memory.writeToMemory(source,data);
+            ADDRESS breakpoint;
+
+            void begin() { }
+            bool breaksAt(ADDRESS pc) const { return pc == breakpoint; }
+            bool breaksInside(ADDRESS start,ADDRESS end) const { return (ADDRESS)(breakpoint - start) < (ADDRESS)(end - start); }
+            bool watchHit() { return false; }
         };
 
-        const function<OPEXEC(ADDRESS)> ASL_ACC = [this](ADDRESS source)
+        struct FULL_DEBUG // Debugger bitmaps, plus the runUntil() breakpoint if there is one
         {
-            CARRY = A & 0x80;
-            A <<= 1;
-            A &= 0xFF;
-            NEGATIVE = A & 0x80;
-            ZERO = !A;
+            Debugger* debugger;
+            bool checkBreakpoint;
+            ADDRESS breakpoint;
+
+            void begin() { debugger->takeHit(); } // hits of earlier tick() calls do not stop this run
+            bool breaksAt(ADDRESS pc) const { return debugger->isBreakpoint(pc) || (checkBreakpoint && pc == breakpoint); }
+            bool breaksInside(ADDRESS start,ADDRESS end) const
+            {
+                return debugger->hasBreakpointIn(start,end) || (checkBreakpoint && (ADDRESS)(breakpoint - start) < (ADDRESS)(end - start));
+            }
+            bool watchHit() { return debugger->takeHit(); }
         };
 
-        const function<OPEXEC(ADDRESS)> BCC = [this](ADDRESS source)
+        template<DISPATCH BACKEND,Variant VARIANT,typename DEBUG,bool INSTRUMENTED = false,bool COVERED = false>
+        STOP_REASON runLoop(uint64_t endCycle,DEBUG debug);
+
+        template<typename DEBUG>
+        STOP_REASON runVariant(uint64_t endCycle,DEBUG debug);
+
+        template<Variant VARIANT,typename DEBUG>
+        STOP_REASON runPolicy(uint64_t endCycle,DEBUG debug); // picks instrumentation and coverage
+
+        template<Variant VARIANT,typename DEBUG,bool COVERED>
+        STOP_REASON runBackend(uint64_t endCycle,DEBUG debug);
+
+        STOP_REASON runDispatch(uint64_t endCycle,bool checkBreakpoint,ADDRESS breakpoint);
+
+        /*------------------------BLOCK CACHE------------------------*/
+        using DECODED_HANDLER = void (*)(CPU&,ADDRESS);
+
+        struct MICRO_OP
         {
-            if(!CARRY)
-                programCounter = source;
+            DECODED_HANDLER handler;
+            ADDRESS operand; // pre-extracted, REL already holds the branch target
+            ADDRESS nextPC;
+            uint8_t cycles;
+            uint8_t opcode;
         };
 
-        const function<OPEXEC(ADDRESS)> BCS = [this](ADDRESS source)
+        struct BLOCK
         {
-            if(CARRY)
-                programCounter = source;
+            ADDRESS start,end; // covers [start,end)
+            uint32_t cycles;   // sum of all MICRO_OP cycles, every page crossing counted
+            uint32_t lastStart; // at most this many cycles are spent before the last MICRO_OP starts
+            std::vector<MICRO_OP> ops;
+
+            uint16_t hits = 0; // runs so far, stops counting once translation was tried
+            JIT::TRANSLATION native; // leading native.count ops as host code
         };
 
-        const function<OPEXEC(ADDRESS)> BEQ = [this](ADDRESS source)
+        struct BLOCK_CACHE
         {
-            if(ZERO)
-                programCounter = source;
+            std::unordered_map<ADDRESS,BLOCK> blocks; // keyed by start PC
+            std::vector<ADDRESS> pageBlocks[256];     // starts of blocks covering each page
+            uint64_t pendingPages[4] = { 0,0,0,0 };   // code pages written, dropped before the next block
+            bool pending = false;
+            uint32_t mappingEpoch = 0;
         };
 
-        const function<OPEXEC(ADDRESS)> BIT = [this](ADDRESS source)
+        std::unique_ptr<BLOCK_CACHE> blockCache; // only with DISPATCH::BLOCK_CACHE
+
+        static const uint16_t JIT_THRESHOLD = 16; // block runs before it is translated
+
+        std::unique_ptr<JIT> jit; // only with DISPATCH::JIT on a supported host
+
+        bool lockstep = false;
+        ADDRESS lockstepMismatch = 0;
+
+        static const std::array<DECODED_HANDLER,256> DECODED_HANDLERS[VARIANT_COUNT];
+
+        template<Variant VARIANT,Mnemonic OPERATION,AddrMode MODE>
+        static void DecodedOp(CPU& cpu,ADDRESS operand); // handler with operand bytes already fetched
+
+        template<Variant VARIANT,std::size_t... OPCODE>
+        static constexpr std::array<DECODED_HANDLER,256> makeDecodedTable(std::index_sequence<OPCODE...>);
+
+        template<Variant VARIANT,AddrMode MODE,bool PAGE_CROSS_CYCLE>
+        ADDRESS resolveDecoded(ADDRESS operand);
+
+        BLOCK* findBlock(ADDRESS address); // decode on a miss, nullptr if code is not in host memory
+
+        void flushInvalidatedBlocks();
+
+        void flushAllBlocks(); // also drops all native code
+
+        size_t runNative(BLOCK& block); // returns how many ops of block already ran
+
+        size_t runLockstep(BLOCK& block,JIT::CONTEXT& context);
+
+        void loadContext(const JIT::CONTEXT& context);
+
+        template<Variant VARIANT,typename DEBUG,bool COVERED>
+        bool runBlock(uint64_t endCycle,DEBUG debug); // false if the next instruction has to be stepped
+
+        template<Variant VARIANT,Mnemonic OPERATION,AddrMode MODE>
+        static void Op(CPU& cpu); // specialized handler for one OPCODE
+
+        template<Variant VARIANT,std::size_t... OPCODE>
+        static constexpr std::array<HANDLER,256> makeHandlerTable(std::index_sequence<OPCODE...>);
+
+        template<Variant VARIANT,AddrMode MODE,bool PAGE_CROSS_CYCLE>
+        ADDRESS resolve(); // addressing mode selected at compile time, see addsPageCrossCycle()
+
+        template<Variant VARIANT,Mnemonic OPERATION,AddrMode MODE>
+        OPEXEC operate(ADDRESS source); // operation selected at compile time, MODE picks its memory accessors
+
+        /*------------------------FLAGS------------------------*/
+        // C,I,D,V live in P, its N and Z bits stay clear. N and Z are only derived from nz when read:
+        // Z is set when the low byte is 0, N is bit 7 of either byte (high byte lets BIT and PLP set N alone)
+        bool carry() const { return P & CARRY_FLAG; }
+        bool zero() const { return !(nz & 0xFF); }
+        bool negative() const { return (nz | (nz >> 8)) & 0x80; }
+        bool overflow() const { return P & OVERFLOW_FLAG; }
+
+        void setFlag(uint8_t flag,bool value) { P = value ? P | flag : P & ~flag; }
+
+        void setZero(bool value) { nz = (value ? 0 : 1) | (negative() ? 0x8000 : 0); } // N stays as it was
+
+        uint8_t status() const { return P | (zero() ? ZERO_FLAG : 0) | (negative() ? NEGATIVE_FLAG : 0); } // as pushed, without B and bit 5
+
+        void setStatus(uint8_t value)
         {
-            uint16_t data = memory.readFromMemory(source) & A;
-            ZERO = !data;
-            NEGATIVE = data & 0x80;
-            
-        };
+            P = value & (CARRY_FLAG | INTERRUPT_DISABLE_FLAG | DECIMAL_FLAG | OVERFLOW_FLAG);
+            nz = ((value & ZERO_FLAG) ? 0 : 1) | ((value & NEGATIVE_FLAG) << 8);
+        }
 
-        const function<OPEXEC(ADDRESS)> BMI = [this](ADDRESS source)
+        /*------------------------OPERATIONS------------------------*/
+        template<Variant VARIANT,AddrMode MODE>
+        OPEXEC ADC(ADDRESS source)
         {
-            if(NEGATIVE)
-                programCounter = source;
-        };
+            uint8_t data = load<MODE>(source);
+            unsigned int temp = data + A + (P & CARRY_FLAG);
+
+            if(hasDecimalMode(VARIANT) && (P & DECIMAL_FLAG))
+            {
+                uint8_t binary = temp & 0xFF; // Z comes from the binary sum
+                if(((A & 0xF) + (data & 0xF) + (P & CARRY_FLAG)) > 9) temp += 6;
+                nz = (binary ? 1 : 0) | ((temp & 0x80) << 8);
+                setFlag(OVERFLOW_FLAG,!((A ^ data) & 0x80) && ((A ^ temp) & 0x80));
+                if(temp > 0x99) temp += 96;
+                setFlag(CARRY_FLAG,temp > 0x99);
+                A = temp & 0xFF;
+                if(addsDecimalCycle(VARIANT)) // 65C02 spends a cycle on N and Z of the decimal result
+                {
+                    currentCycle++;
+                    nz = A;
+                }
+                return;
+            }
+
+            setFlag(OVERFLOW_FLAG,~(A ^ data) & (A ^ temp) & 0x80);
+            setFlag(CARRY_FLAG,temp > 0xFF);
+            A = temp & 0xFF;
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> BNE = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC AND(ADDRESS source)
         {
-            if(!ZERO)
-                programCounter = source;
-        };
+            A = A & load<MODE>(source);
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> BPL = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC ASL(ADDRESS source)
         {
-            if(!NEGATIVE)
-                programCounter = source;
-        };
+            uint8_t data = load<MODE>(source);
+            setFlag(CARRY_FLAG,data & 0x80);
+            data <<= 1;
+            nz = data;
+            store<MODE>(source,data);
+        }
+
+        OPEXEC ASL_ACC(ADDRESS source)
+        {
+            setFlag(CARRY_FLAG,A & 0x80);
+            A <<= 1;
+            nz = A;
+        }
+
+        OPEXEC BRANCH(bool taken,ADDRESS target) // BCC,BCS,BEQ,BMI,BNE,BPL,BVC,BVS
+        {
+            if(!taken) return;
+            ADDRESS next = programCounter;
+            currentCycle += 1 + ((next ^ target) > 0xFF); // one more if target is on another page
+            programCounter = target;
+            jumped(next);
+        }
+
+        OPEXEC BCC(ADDRESS source)
+        {
+            BRANCH(!carry(),source);
+        }
+
+        OPEXEC BCS(ADDRESS source)
+        {
+            BRANCH(carry(),source);
+        }
+
+        OPEXEC BEQ(ADDRESS source)
+        {
+            BRANCH(zero(),source);
+        }
+
+        template<AddrMode MODE>
+        OPEXEC BIT(ADDRESS source)
+        {
+            uint8_t data = load<MODE>(source);
+            setFlag(OVERFLOW_FLAG,data & 0x40);
+            nz = (data & A) | ((data & 0x80) << 8); // N and V come from memory, Z from the AND
+        }
+
+        OPEXEC BIT_IMM(ADDRESS source)
+        {
+            setZero(!(read(source) & A)); // N and V stay
+        }
+
+        OPEXEC BMI(ADDRESS source)
+        {
+            BRANCH(negative(),source);
+        }
+
+        OPEXEC BNE(ADDRESS source)
+        {
+            BRANCH(!zero(),source);
+        }
 
-        const function<OPEXEC(ADDRESS)> BRK = [this](ADDRESS source)
+        OPEXEC BPL(ADDRESS source)
+        {
+            BRANCH(!negative(),source);
+        }
+
+        OPEXEC BRA(ADDRESS source)
+        {
+            BRANCH(true,source);
+        }
+
+        template<Variant VARIANT>
+        OPEXEC BRK(ADDRESS source)
         {
-            uint8_t flagByte = 0xFF;
-            flagByte |= 1UL << BREAK_BIT;
-            CARRY ? flagByte |= 1UL << CARRY_BIT : flagByte &= ~(1UL << CARRY_BIT);
-            ZERO ? flagByte |= 1UL << ZERO_BIT : flagByte &= ~(1UL << ZERO_BIT);
-            INTERRUPT_DISABLE ? flagByte |= 1UL << INTERRUPT_DISABLE_BIT : flagByte &= ~(1UL << INTERRUPT_DISABLE_BIT);
-            DECIMAL ? flagByte |= 1UL << DECIMAL_MODE_BIT : flagByte &= ~(1UL << DECIMAL_MODE_BIT);
-            OVERFLOWBIT ? flagByte |= 1UL << OVERFLOW_BIT : flagByte &= ~(1UL << OVERFLOW_BIT);
-            NEGATIVE ? flagByte |= 1UL << NEGATIVE_BIT : flagByte &= ~(1UL << NEGATIVE_BIT);
             programCounter++;
             push((programCounter >> 8) & 0xFF);
             push(programCounter & 0xFF);
-            push(flagByte);
+            push(status() | BREAK_FLAG | UNUSED_FLAG);
 
-            INTERRUPT_DISABLE = 1;
-            programCounter = (memory.readFromMemory(IRQVECTOR_H) << 8) + memory.readFromMemory(IRQVECTOR_L);
-        };
+            P |= INTERRUPT_DISABLE_FLAG;
+            if(clearsDecimalOnInterrupt(VARIANT)) P &= ~DECIMAL_FLAG;
+            ADDRESS next = programCounter;
+            programCounter = (read(IRQVECTOR_H) << 8) + read(IRQVECTOR_L);
+            jumped(next);
+        }
 
-        const function<OPEXEC(ADDRESS)> BVC = [this](ADDRESS source)
+        OPEXEC BVC(ADDRESS source)
         {
-            if(!OVERFLOWBIT)
-                programCounter = source;
-        };
+            BRANCH(!overflow(),source);
+        }
 
-        const function<OPEXEC(ADDRESS)> BVS = [this](ADDRESS source)
+        OPEXEC BVS(ADDRESS source)
         {
-            if(OVERFLOWBIT)
-                programCounter = source;
-        };
+            BRANCH(overflow(),source);
+        }
 
-        const function<OPEXEC(ADDRESS)> CLC = [this](ADDRESS source)
+        OPEXEC CLC(ADDRESS source)
         {
-            CARRY = 0;
-        };
+            P &= ~CARRY_FLAG;
+        }
 
-        const function<OPEXEC(ADDRESS)> CLD = [this](ADDRESS source)
+        OPEXEC CLD(ADDRESS source)
         {
-            DECIMAL = 0;
-        };
+            P &= ~DECIMAL_FLAG;
+        }
 
-        const function<OPEXEC(ADDRESS)> CLI = [this](ADDRESS source)
+        OPEXEC CLI(ADDRESS source)
         {
-            INTERRUPT_DISABLE = 0;
-        };
+            P &= ~INTERRUPT_DISABLE_FLAG;
+            pollPendingIRQ();
+        }
 
-        const function<OPEXEC(ADDRESS)> CLV = [this](ADDRESS source)
+        OPEXEC CLV(ADDRESS source)
         {
-            OVERFLOWBIT = 0;
-        };
+            P &= ~OVERFLOW_FLAG;
+        }
 
-        const function<OPEXEC(ADDRESS)> CMP = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC COMPARE(uint8_t reg,ADDRESS source) // CMP,CPX,CPY
         {
-            uint8_t data = A - memory.readFromMemory(source);
-            CARRY = (0x100 > data) ? 1 : 0;
-            NEGATIVE = (0x80 & data) ? 1 : 0;
-            ZERO = (data & 0xFF) ? 0 : 1;
-        };
+            uint8_t data = load<MODE>(source);
+            setFlag(CARRY_FLAG,reg >= data);
+            nz = (uint8_t)(reg - data);
+        }
 
-        const function<OPEXEC(ADDRESS)> CPX = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC CMP(ADDRESS source)
         {
-            uint8_t data = X - memory.readFromMemory(source);
-            CARRY = (0x100 > data) ? 1 : 0;
-            NEGATIVE = (0x80 & data) ? 1 : 0;
-            ZERO = (data & 0xFF) ? 0 : 1;
-        };
+            COMPARE<MODE>(A,source);
+        }
 
-        const function<OPEXEC(ADDRESS)> CPY = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC CPX(ADDRESS source)
         {
-            uint8_t data = Y - memory.readFromMemory(source);
-            CARRY = (0x100 > data) ? 1 : 0;
-            NEGATIVE = (0x80 & data) ? 1 : 0;
-            ZERO = (data & 0xFF) ? 0 : 1;
-        };
+            COMPARE<MODE>(X,source);
+        }
 
-        const function<OPEXEC(ADDRESS)> DEC = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC CPY(ADDRESS source)
         {
-            uint8_t data = memory.readFromMemory(source) - 1;
-            NEGATIVE = data & 0x80;
-            ZERO = !data;
-            memory.writeToMemory(source,data);
-        };
+            COMPARE<MODE>(Y,source);
+        }
 
-        const function<OPEXEC(ADDRESS)> DEX = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC DEC(ADDRESS source)
         {
-            uint8_t data = X - 1;
-            NEGATIVE = data & 0x80;
-            ZERO = !data;
-            X = data;
-        };
+            uint8_t data = load<MODE>(source) - 1;
+            nz = data;
+            store<MODE>(source,data);
+        }
 
-        const function<OPEXEC(ADDRESS)> DEY = [this](ADDRESS source)
+        OPEXEC DEC_ACC(ADDRESS source)
         {
-            uint8_t data = Y - 1;
-            NEGATIVE = data & 0x80;
-            ZERO = !data;
-            Y = data;
-        };
+            A--;
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> EOR = [this](ADDRESS source)
+        OPEXEC DEX(ADDRESS source)
         {
-            uint8_t data = A ^ memory.readFromMemory(source);
-            NEGATIVE = data & 0x80;
-            ZERO = data == 0 ? 1 : 0;
-            A = data;
-        };
+            X--;
+            nz = X;
+        }
 
-        const function<OPEXEC(ADDRESS)> INC = [this](ADDRESS source)
+        OPEXEC DEY(ADDRESS source)
         {
-            uint8_t data = (memory.readFromMemory(source) + 1) % 256;
-            ZERO = !data;
-            NEGATIVE = data & 0x80;
-            memory.writeToMemory(source,data);
-        };
+            Y--;
+            nz = Y;
+        }
 
-        const function<OPEXEC(ADDRESS)> INX_OP = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC EOR(ADDRESS source)
         {
-            X = (X + 1) % 256;
-            ZERO = !X;
-            NEGATIVE = X & 0x80;
-        };
+            A ^= load<MODE>(source);
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> INY_OP = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC INC(ADDRESS source)
         {
-            Y = (Y + 1) % 256;
-            ZERO = !Y;
-            NEGATIVE = Y & 0x80;
-        };
+            uint8_t data = load<MODE>(source) + 1;
+            nz = data;
+            store<MODE>(source,data);
+        }
+
+        OPEXEC INC_ACC(ADDRESS source)
+        {
+            A++;
+            nz = A;
+        }
+
+        OPEXEC INX_OP(ADDRESS source)
+        {
+            X++;
+            nz = X;
+        }
+
+        OPEXEC INY_OP(ADDRESS source)
+        {
+            Y++;
+            nz = Y;
+        }
 
-        const function<OPEXEC(ADDRESS)> JMP = [this](ADDRESS source)
+        OPEXEC JMP(ADDRESS source)
         {
+            ADDRESS next = programCounter;
             programCounter = source;
-        };
+            jumped(next);
+        }
 
-        const function<OPEXEC(ADDRESS)> JSR = [this](ADDRESS source)
+        OPEXEC JSR(ADDRESS source)
         {
+            ADDRESS next = programCounter;
             programCounter--;
             push((programCounter >> 8) &  0xFF);
             push(programCounter & 0xFF);
             programCounter = source;
-        };
+            jumped(next);
+        }
 
-        const function<OPEXEC(ADDRESS)> LDA = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC LDA(ADDRESS source)
         {
-            A = memory.readFromMemory(source);
-            ZERO = !A;
-            NEGATIVE = 	A & 0x80;
-        };
+            A = load<MODE>(source);
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> LDX = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC LDX(ADDRESS source)
         {
-            X = memory.readFromMemory(source);
-            ZERO = !X;
-            NEGATIVE = 	X & 0x80;
-        };
+            X = load<MODE>(source);
+            nz = X;
+        }
 
-        const function<OPEXEC(ADDRESS)> LDY = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC LDY(ADDRESS source)
         {
-            Y = memory.readFromMemory(source);
-            ZERO = !Y;
-            NEGATIVE = 	Y & 0x80;
-        };
+            Y = load<MODE>(source);
+            nz = Y;
+        }
 
-        const function<OPEXEC(ADDRESS)> LSR = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC LSR(ADDRESS source)
         {
-            uint8_t data = memory.readFromMemory(source);
-            CARRY = data & 0x01;
+            uint8_t data = load<MODE>(source);
+            setFlag(CARRY_FLAG,data & 0x01);
             data >>= 1;
-            ZERO = !data;
-            NEGATIVE = 0;
-            memory.writeToMemory(source,data);
-        };
+            nz = data;
+            store<MODE>(source,data);
+        }
 
-        const function<OPEXEC(ADDRESS)> LSR_ACC = [this](ADDRESS source)
+        OPEXEC LSR_ACC(ADDRESS source)
         {
-            CARRY = A & 0x01;
+            setFlag(CARRY_FLAG,A & 0x01);
             A >>= 1;
-            ZERO = !A;
-            NEGATIVE = 0;
-        };
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> NOP = [this](ADDRESS source) { };;
+        OPEXEC NOP(ADDRESS source) { }
 
-        const function<OPEXEC(ADDRESS)> ORA = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC ORA(ADDRESS source)
         {
-            A = memory.readFromMemory(source) | A;
-            ZERO = !A;
-            NEGATIVE = A & 0x80;
-        };
+            A |= load<MODE>(source);
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> PHA = [this](ADDRESS source)
+        OPEXEC PHA(ADDRESS source)
         {
             push(A);
-        };
+        }
 
-        const function<OPEXEC(ADDRESS)> PHP = [this](ADDRESS source)
+        OPEXEC PHP(ADDRESS source)
         {
-            uint8_t flagByte = 0xFF;
-            flagByte |= 1UL << BREAK_BIT;
-            CARRY ? flagByte |= 1UL << CARRY_BIT : flagByte &= ~(1UL << CARRY_BIT);
-            ZERO ? flagByte |= 1UL << ZERO_BIT : flagByte &= ~(1UL << ZERO_BIT);
-            INTERRUPT_DISABLE ? flagByte |= 1UL << INTERRUPT_DISABLE_BIT : flagByte &= ~(1UL << INTERRUPT_DISABLE_BIT);
-            DECIMAL ? flagByte |= 1UL << DECIMAL_MODE_BIT : flagByte &= ~(1UL << DECIMAL_MODE_BIT);
-            OVERFLOWBIT ? flagByte |= 1UL << OVERFLOW_BIT : flagByte &= ~(1UL << OVERFLOW_BIT);
-            NEGATIVE ? flagByte |= 1UL << NEGATIVE_BIT : flagByte &= ~(1UL << NEGATIVE_BIT);
+            push(status() | BREAK_FLAG | UNUSED_FLAG);
+        }
 
-            push(flagByte);	
-        };
-
-        const function<OPEXEC(ADDRESS)> PLA = [this](ADDRESS source)
+        OPEXEC PHX(ADDRESS source)
         {
-            A = pop();
-        };
+            push(X);
+        }
 
-        const function<OPEXEC(ADDRESS)> PLP = [this](ADDRESS source)
+        OPEXEC PHY(ADDRESS source)
         {
-            uint8_t data = pop();
-            CARRY = (data >> CARRY_BIT) & 1;
-            ZERO = (data >> ZERO_BIT) & 1;
-            DECIMAL = (data >> DECIMAL_MODE_BIT) & 1;
-            BREAK = (data >> BREAK_BIT) & 1;
-            OVERFLOWBIT = (data >> OVERFLOW_BIT) & 1;
-            NEGATIVE = (data >> NEGATIVE_BIT) & 1;	
-        };
+            push(Y);
+        }
 
-        const function<OPEXEC(ADDRESS)> ROL = [this](ADDRESS source)
+        OPEXEC PLA(ADDRESS source)
         {
-            uint8_t data = memory.readFromMemory(source);
-            data <<= 1;
-            if(CARRY) data |= 0x01;
-            CARRY = data > 0xFF;
-            data &= 0xFF;
-            ZERO = !data;
-            NEGATIVE = data & 0x80;
-            memory.writeToMemory(source,data);
-        };
+            A = pop();
+            nz = A;
+        }
 
+        OPEXEC PLX(ADDRESS source)
+        {
+            X = pop();
+            nz = X;
+        }
 
-        const function<OPEXEC(ADDRESS)> ROL_ACC = [this](ADDRESS source)
+        OPEXEC PLY(ADDRESS source)
         {
-            A <<= 1;
-            if(CARRY) A |= 0x01;
-            CARRY = A > 0xFF;
-            A &= 0xFF;
-            ZERO = !A;
-            NEGATIVE = A & 0x80;
-        };
+            Y = pop();
+            nz = Y;
+        }
 
-        const function<OPEXEC(ADDRESS)> ROR = [this](ADDRESS source)
+        OPEXEC PLP(ADDRESS source)
         {
-            uint8_t data = memory.readFromMemory(source);
-            if(CARRY) data |= 0x100;
-            CARRY = data & 0x01;
-            data >>= 1;
-            data &= 0xFF;
-            NEGATIVE = data & 0x80;
-            ZERO = !data;
-            memory.writeToMemory(source,data);
-        };
+            setStatus(pop());
+            pollPendingIRQ();
+        }
 
-        const function<OPEXEC(ADDRESS)> ROR_ACC = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC ROL(ADDRESS source)
         {
-            uint8_t data = A;
-            if(CARRY) data |= 0x100;
-            CARRY = data & 0x01;
-            data >>= 1;
-            data &= 0xFF;
-            NEGATIVE = data & 0x80;
-            ZERO = !data;
-            A = data;
-        };
+            uint8_t data = load<MODE>(source);
+            uint8_t result = (data << 1) | (P & CARRY_FLAG);
+            setFlag(CARRY_FLAG,data & 0x80);
+            nz = result;
+            store<MODE>(source,result);
+        }
+
+        OPEXEC ROL_ACC(ADDRESS source)
+        {
+            uint8_t result = (A << 1) | (P & CARRY_FLAG);
+            setFlag(CARRY_FLAG,A & 0x80);
+            A = result;
+            nz = A;
+        }
+
+        template<AddrMode MODE>
+        OPEXEC ROR(ADDRESS source)
+        {
+            uint8_t data = load<MODE>(source);
+            uint8_t result = (data >> 1) | ((P & CARRY_FLAG) << 7);
+            setFlag(CARRY_FLAG,data & 0x01);
+            nz = result;
+            store<MODE>(source,result);
+        }
+
+        OPEXEC ROR_ACC(ADDRESS source)
+        {
+            uint8_t result = (A >> 1) | ((P & CARRY_FLAG) << 7);
+            setFlag(CARRY_FLAG,A & 0x01);
+            A = result;
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> RTI = [this](ADDRESS source)
+        OPEXEC RTI(ADDRESS source)
         {
-            uint8_t low,high,flagByte;
-            flagByte = pop();
-            
-            CARRY = (flagByte >> CARRY_BIT) & 1;
-            ZERO = (flagByte >> ZERO_BIT) & 1;
-            DECIMAL = (flagByte >> DECIMAL_MODE_BIT) & 1;
-            BREAK = (flagByte >> BREAK_BIT) & 1;
-            OVERFLOWBIT = (flagByte >> OVERFLOW_BIT) & 1;
-            NEGATIVE = (flagByte >> NEGATIVE_BIT) & 1;	
+            uint8_t low,high;
+            setStatus(pop());
 
             low = pop();
             high = pop();
 
+            ADDRESS next = programCounter;
             programCounter = (high << 8) | low; 
-        };
+            jumped(next);
+            pollPendingIRQ();
+        }
 
-        const function<OPEXEC(ADDRESS)> RTS = [this](ADDRESS source)
+        OPEXEC RTS(ADDRESS source)
         {
             uint8_t low,high;
 
             low = pop();
             high = pop();
 
+            ADDRESS next = programCounter;
             programCounter = ((high << 8) | low) + 1;
-        };
+            jumped(next);
+        }
 
-        const function<OPEXEC(ADDRESS)> SBC = [this](ADDRESS source)
+        template<Variant VARIANT,AddrMode MODE>
+        OPEXEC SBC(ADDRESS source)
         {
-            uint8_t data = memory.readFromMemory(source);
-            uint32_t temp = A - data - (CARRY ? 1 : 0);
-            NEGATIVE = temp & 0x80;
-            ZERO = !(temp & 0xFF);
-            OVERFLOWBIT = ((A ^ temp) & 0x80) && ((A ^ data) & 0x80);
+            uint8_t data = load<MODE>(source);
+            uint8_t borrow = (P & CARRY_FLAG) ^ 1;
+            uint32_t temp = A - data - borrow;
+            nz = temp & 0xFF;
+            setFlag(OVERFLOW_FLAG,((A ^ temp) & 0x80) && ((A ^ data) & 0x80));
 
-            if(DECIMAL)
+            if(hasDecimalMode(VARIANT) && (P & DECIMAL_FLAG))
             {
-                if( ((A & 0x0F)  - CARRY)  < (data & 0x0F)) temp -= 6;
+                if( ((A & 0x0F)  - borrow)  < (data & 0x0F)) temp -= 6;
                 if(temp > 0x99)
                     temp -= 0x60; 
+                if(addsDecimalCycle(VARIANT))
+                {
+                    currentCycle++;
+                    nz = temp & 0xFF;
+                }
             };  
-            CARRY = temp < 0x100;
+            setFlag(CARRY_FLAG,temp < 0x100);
             A = (temp & 0xFF);
-        };
+        }
 
-        const function<OPEXEC(ADDRESS)> SEC = [this](ADDRESS source)
+        OPEXEC SEC(ADDRESS source)
         {
-            CARRY = 1;
-        };
+            P |= CARRY_FLAG;
+        }
 
-        const function<OPEXEC(ADDRESS)> SED = [this](ADDRESS source)
+        OPEXEC SED(ADDRESS source)
         {
-            DECIMAL = 1;
-        };
+            P |= DECIMAL_FLAG;
+        }
 
-        const function<OPEXEC(ADDRESS)> SEI = [this](ADDRESS source)
+        OPEXEC SEI(ADDRESS source)
         {
-            INTERRUPT_DISABLE = 1;
-        };
+            P |= INTERRUPT_DISABLE_FLAG;
+        }
 
-        const function<OPEXEC(ADDRESS)> STA = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC STA(ADDRESS source)
         {
-            memory.writeToMemory(source,A);
-        };
+            store<MODE>(source,A);
+        }
 
-        const function<OPEXEC(ADDRESS)> STX = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC STX(ADDRESS source)
         {
-            memory.writeToMemory(source,X);
-        };
+            store<MODE>(source,X);
+        }
 
-        const function<OPEXEC(ADDRESS)> STY = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC STY(ADDRESS source)
         {
-            memory.writeToMemory(source,Y);
-        };
+            store<MODE>(source,Y);
+        }
+
+        template<AddrMode MODE>
+        OPEXEC STZ(ADDRESS source)
+        {
+            store<MODE>(source,0);
+        }
 
-        const function<OPEXEC(ADDRESS)> TAX = [this](ADDRESS source)
+        OPEXEC TAX(ADDRESS source)
         {
             X = A;
-            ZERO = !X;
-            NEGATIVE = X & 0x80;
-        };
+            nz = X;
+        }
 
-        const function<OPEXEC(ADDRESS)> TAY = [this](ADDRESS source)
+        OPEXEC TAY(ADDRESS source)
         {
             Y = A;
-            ZERO = !Y;
-            NEGATIVE = Y & 0x80;
-        };
+            nz = Y;
+        }
+
+        template<AddrMode MODE>
+        OPEXEC TRB(ADDRESS source) // clear the bits of A in memory
+        {
+            uint8_t data = load<MODE>(source);
+            setZero(!(data & A));
+            store<MODE>(source,data & ~A);
+        }
 
-        const function<OPEXEC(ADDRESS)> TSX = [this](ADDRESS source)
+        template<AddrMode MODE>
+        OPEXEC TSB(ADDRESS source) // set the bits of A in memory
+        {
+            uint8_t data = load<MODE>(source);
+            setZero(!(data & A));
+            store<MODE>(source,data | A);
+        }
+
+        OPEXEC TSX(ADDRESS source)
         {
             X = SP;
-            ZERO = !X;
-            NEGATIVE = X & 0x80;
-        };
+            nz = X;
+        }
 
-        const function<OPEXEC(ADDRESS)> TXA = [this](ADDRESS source)
+        OPEXEC TXA(ADDRESS source)
         {
             A = X;
-            ZERO = !X;
-            NEGATIVE = X & 0x80;
-        };
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> TYA = [this](ADDRESS source)
+        OPEXEC TYA(ADDRESS source)
         {
             A = Y;
-            ZERO = !Y;
-            NEGATIVE = Y & 0x80;
-        };
+            nz = A;
+        }
 
-        const function<OPEXEC(ADDRESS)> TXS = [this](ADDRESS source)
+        OPEXEC TXS(ADDRESS source)
         {
             SP = X;	
-        };
+        }
 
-        const function<OPEXEC(ADDRESS)> ILLEGAL = [this](ADDRESS source)
+        OPEXEC ILLEGAL(ADDRESS source)
         {
-            exit(1);
-        };
+            programCounter--; // stay on the OPCODE so the host can inspect it
+            halted = true;
+            haltReason = STOP_REASON::ILLEGAL_OPCODE;
+        }
+
+        OPEXEC JAM(ADDRESS source)
+        {
+            programCounter--; // processor locks up until reset
+            halted = true;
+            haltReason = STOP_REASON::JAM;
+        }
       
         /*------------ADDRESSING MODES--------*/
-        const function<ADDRESS()> ACC = [this]() { return A; }; // ACCUMULATOR
-        const function<ADDRESS()> IMM = [this]() { return programCounter++; }; // IMMEDIATE
-        const function<ADDRESS()> ABS = [this]() { uint16_t addrLower = memory.readFromMemory(programCounter++),
-                                                        addrHigher = memory.readFromMemory(programCounter++); 
-                                                        return addrLower + (addrHigher << 8); };  // ABSOLUTE
-        const function<ADDRESS()> ZER = [this]() { return memory.readFromMemory(programCounter++); }; // ZERO PAGE
-        const function<ADDRESS()> ZEX = [this]() { return (memory.readFromMemory(programCounter++) + X) % 256; }; // INDEXED-X ZERO PAGE
-        const function<ADDRESS()> ZEY = [this]() { return (memory.readFromMemory(programCounter++) + Y) % 256; }; // INDEXED-Y ZERO PAGE
-        const function<ADDRESS()> ABX = [this]() { return ABS() + X; }; // INDEXED-X ABSOLUTE
-        const function<ADDRESS()> ABY = [this]() { return ABS() + X; }; // INDEXED-Y ABSOLUTE
-        const function<ADDRESS()> IMP = [this]() { return 0; }; // IMPLIED
-        const function<ADDRESS()> REL = [this]() { uint16_t offset = (uint16_t) memory.readFromMemory(programCounter++); 
-                                                        if(offset & 0x80) offset |= 0xFF00; 
-                                                        return programCounter + (int16_t) offset; }; // RELATIVE
-        const function<ADDRESS()> INX = [this]() { uint16_t zeroLower = ZEX(),zeroHigher = (zeroLower + 1) % 256; 
-                                                        return memory.readFromMemory(zeroLower) + (memory.readFromMemory(zeroHigher) << 8); }; // INDEXED-X INDIRECT
-        const function<ADDRESS()> INY = [this]() { uint16_t zeroLower = memory.readFromMemory(programCounter++),
-                                                        zeroHigher = (zeroLower + 1) % 256; 
-                                                        return memory.readFromMemory(zeroLower) + (memory.readFromMemory(zeroHigher) << 8) + Y; }; // INDEXED-Y INDIRECT
-        const function<ADDRESS()> ABI = [this]() { uint16_t addressLower = memory.readFromMemory(programCounter++),
-                                                        addressHigher = memory.readFromMemory(programCounter++),
-                                                        abs = (addressHigher << 8) | addressLower,
-                                                        effLower = memory.readFromMemory(abs),
-                                                        effHigher = memory.readFromMemory((abs & 0xFF00) + ((abs + 1) & 0x00FF));
-                                                        return effLower + 0x100 * effHigher; }; // ABSOLUTE INDIRECT
+        ADDRESS ACC() { return A; } // ACCUMULATOR
+        ADDRESS IMM() { return programCounter++; } // IMMEDIATE
+        ADDRESS ABS() { uint16_t addrLower = read(programCounter++),
+                        addrHigher = read(programCounter++); 
+                        return addrLower + (addrHigher << 8); } // ABSOLUTE
+        ADDRESS ZER() { return read(programCounter++); } // ZERO PAGE
+        ADDRESS ZEX() { return (read(programCounter++) + X) % 256; } // INDEXED-X ZERO PAGE
+        ADDRESS ZEY() { return (read(programCounter++) + Y) % 256; } // INDEXED-Y ZERO PAGE
+        template<bool PAGE_CROSS_CYCLE>
+        ADDRESS indexed(ADDRESS base,uint8_t index) // base + index, one cycle more on carry into the high byte
+        {
+            if(PAGE_CROSS_CYCLE) currentCycle += ((base & 0xFF) + index) >> 8;
+            return base + index;
+        }
+
+        template<bool PAGE_CROSS_CYCLE>
+        ADDRESS ABX() { return indexed<PAGE_CROSS_CYCLE>(ABS(),X); } // INDEXED-X ABSOLUTE
+        template<bool PAGE_CROSS_CYCLE>
+        ADDRESS ABY() { return indexed<PAGE_CROSS_CYCLE>(ABS(),Y); } // INDEXED-Y ABSOLUTE
+        ADDRESS IMP() { return 0; } // IMPLIED
+        ADDRESS REL() { uint16_t offset = (uint16_t) read(programCounter++); 
+                        if(offset & 0x80) offset |= 0xFF00; 
+                        return programCounter + (int16_t) offset; } // RELATIVE
+        ADDRESS INX() { return readPointer(ZEX()); } // INDEXED-X INDIRECT
+        template<bool PAGE_CROSS_CYCLE>
+        ADDRESS INY() { return indexed<PAGE_CROSS_CYCLE>(readPointer(read(programCounter++)),Y); } // INDEXED-Y INDIRECT
+        template<Variant VARIANT>
+        ADDRESS ABI() { uint16_t addressLower = read(programCounter++),
+                        addressHigher = read(programCounter++),
+                        abs = (addressHigher << 8) | addressLower,
+                        effLower = read(abs),
+                        effHigher = read(hasIndirectJumpBug(VARIANT) ? (abs & 0xFF00) + ((abs + 1) & 0x00FF) : (ADDRESS)(abs + 1));
+                        return effLower + 0x100 * effHigher; } // ABSOLUTE INDIRECT
+        ADDRESS ZPI() { return readPointer(read(programCounter++)); } // ZERO PAGE INDIRECT (65C02)
+        ADDRESS AIX() { ADDRESS abs = ABS() + X;
+                        return read(abs) + (read((ADDRESS)(abs + 1)) << 8); } // INDEXED-X ABSOLUTE INDIRECT (65C02)
 
 
 };
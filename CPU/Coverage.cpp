@@ -0,0 +1,47 @@
+#include "Coverage.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+Coverage::Coverage(const char* path)
+{
+	void* memory;
+	if(path)
+	{
+		int file = open(path,O_RDWR | O_CREAT,0600);
+		if(file < 0) return;
+
+		struct stat info;
+		if(fstat(file,&info) || (info.st_size < (off_t)MAP_SIZE && ftruncate(file,MAP_SIZE))) // a fuzzer may have made it already
+		{
+			close(file);
+			return;
+		}
+		memory = mmap(nullptr,MAP_SIZE,PROT_READ | PROT_WRITE,MAP_SHARED,file,0);
+		close(file); // mapping keeps the file
+	}
+	else
+		memory = mmap(nullptr,MAP_SIZE,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+
+	if(memory != MAP_FAILED) map = static_cast<uint8_t*>(memory);
+}
+
+Coverage::~Coverage()
+{
+	if(map) munmap(map,MAP_SIZE);
+}
+
+void Coverage::reset()
+{
+	memset(map,0,MAP_SIZE);
+}
+
+uint32_t Coverage::countEdges() const
+{
+	uint32_t count = 0;
+	for(size_t i = 0;i < MAP_SIZE;i++)
+		count += map[i] != 0;
+	return count;
+}
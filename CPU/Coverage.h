@@ -0,0 +1,76 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+#include "../Utils/handler.h"
+#include "Opcodes.h"
+#include <array>
+
+/*
+
+    EDGE COVERAGE
+
+    AFL style edge bitmap for coverage guided fuzzing of guest programs, filled by CPU while it is
+    attached with CPU::setCoverage(). Every branch (taken or not, BRA on the 65C02), JMP, JSR, RTS, RTI and BRK bumps the
+    saturating 8 bit counter of the edge from its own address to the address it left for:
+    MAP[hash(from) >> 1 ^ hash(to)], the shift keeps A->B and B->A apart like in AFL.
+
+    The map is a 64KB file mapped shared into memory, a fuzzer maps the same file and reads it
+    after every execution, reset() clears it before the next one. Without a path the map is
+    anonymous memory that only the host sees through getMap().
+
+    Edges are recorded on every backend: SWITCH and JUMP_TABLE after each stepped control flow
+    instruction, BLOCK_CACHE and JIT once at the end of a block, which always ends on one. Runs without
+    a Coverage use a run loop that has no coverage check at all.
+
+*/
+
+constexpr std::array<bool,256> makeEdgeTable(Variant variant) // control flow OPCODEs that go on executing
+{
+    std::array<bool,256> table = {};
+    for(int i = 0;i < 256;i++)
+    {
+        Mnemonic operation = opcodeTable(variant)[i].operation;
+        table[i] = changesControlFlow(operation) && operation != Mnemonic::JAM && operation != Mnemonic::ILLEGAL;
+    }
+    return table;
+}
+
+constexpr std::array<std::array<bool,256>,VARIANT_COUNT> EDGE_OPCODES =
+{{
+    makeEdgeTable(Variant::NMOS),makeEdgeTable(Variant::RP2A03),makeEdgeTable(Variant::CMOS)
+}};
+
+class Coverage
+{
+    public:
+        static const size_t MAP_SIZE = 1 << 16;
+
+        explicit Coverage(const char* path = nullptr); // file is created or grown to MAP_SIZE
+
+        ~Coverage();
+
+        Coverage(const Coverage&) = delete;
+
+        bool isOpen() const { return map != nullptr; }
+
+        void edge(ADDRESS from,ADDRESS to)
+        {
+            uint8_t& count = map[(hash(from) >> 1) ^ hash(to)];
+            count += count != 0xFF;
+        }
+
+        void reset(); // zero every counter, call between executions
+
+        uint32_t countEdges() const; // counters that are not 0
+
+        uint8_t* getMap() { return map; }
+
+        static bool isEdge(Variant variant,uint8_t opcode) { return EDGE_OPCODES[static_cast<uint8_t>(variant)][opcode]; } // instruction that ends an edge
+
+    private:
+        uint8_t* map = nullptr;
+
+        static uint16_t hash(ADDRESS address) { return (address * 0x9E3779B1u) >> 16; } // spreads neighbouring PCs over the map
+};
+
+
+#endif
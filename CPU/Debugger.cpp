@@ -0,0 +1,100 @@
+#include "Debugger.h"
+
+Debugger::Debugger(Bus& bus) : bus(bus) { }
+
+Debugger::~Debugger()
+{
+	clear();
+}
+
+void Debugger::setBreakpoint(ADDRESS address,bool enabled)
+{
+	if(enabled) breakpoints[address >> 6] |= 1ULL << (address & 63);
+	else breakpoints[address >> 6] &= ~(1ULL << (address & 63));
+}
+
+void Debugger::setWatchpoint(ADDRESS first,ADDRESS last,uint8_t access)
+{
+	for(uint32_t address = first;address <= last;address++)
+	{
+		uint64_t bit = 1ULL << (address & 63);
+		readWatch[address >> 6] = (access & READ) ? readWatch[address >> 6] | bit : readWatch[address >> 6] & ~bit;
+		writeWatch[address >> 6] = (access & WRITE) ? writeWatch[address >> 6] | bit : writeWatch[address >> 6] & ~bit;
+	}
+	for(uint32_t page = first >> 8;page <= (uint32_t)(last >> 8);page++)
+		updateHook(page);
+}
+
+void Debugger::clear()
+{
+	for(int i = 0;i < 1024;i++)
+		breakpoints[i] = readWatch[i] = writeWatch[i] = 0;
+	for(int page = 0;page < 256;page++)
+		updateHook(page);
+	hitPending = false;
+}
+
+bool Debugger::hasBreakpointIn(ADDRESS start,ADDRESS end) const
+{
+	ADDRESS length = end - start; // blocks may wrap from $FFFF to $0000
+	for(ADDRESS i = 0;i < length;i++) // blocks are short, no need to go a word at a time
+		if(isBreakpoint((ADDRESS)(start + i))) return true;
+	return false;
+}
+
+void Debugger::updateHook(uint8_t page)
+{
+	bool watched = false;
+	for(int word = page * 4;word < page * 4 + 4;word++)
+		watched = watched || readWatch[word] || writeWatch[word];
+
+	if(watched == hooked[page]) return;
+	if(watched)
+	{
+		originalPage[page] = bus.getPage(page << 8);
+		originalMMIO[page] = bus.getMMIO(page << 8);
+		bus.mapHandler(page,page,&Debugger::onRead,&Debugger::onWrite,this);
+		bus.setBackingPage(page,originalPage[page].write); // save states keep copying the RAM under the hook
+	}
+	else
+		bus.restorePage(page,originalPage[page],originalMMIO[page]);
+	hooked[page] = watched;
+}
+
+void Debugger::hit(ADDRESS address,ACCESS access,BYTE value)
+{
+	if(hitPending) return; // first access of the instruction is reported
+	lastHit = { address,access,value };
+	hitPending = true;
+}
+
+BYTE Debugger::onRead(void* context,ADDRESS address)
+{
+	Debugger& debugger = *static_cast<Debugger*>(context);
+	uint8_t page = address >> 8;
+
+	const Bus::PAGE& original = debugger.originalPage[page];
+	const Bus::MMIO& handler = debugger.originalMMIO[page];
+	BYTE value = original.read ? original.read[address & 0xFF] : handler.read(handler.context,address);
+
+	if(debugger.isWatched(address,debugger.readWatch)) debugger.hit(address,READ,value);
+	return value;
+}
+
+void Debugger::onWrite(void* context,ADDRESS address,BYTE value)
+{
+	Debugger& debugger = *static_cast<Debugger*>(context);
+	uint8_t page = address >> 8;
+
+	const Bus::PAGE& original = debugger.originalPage[page];
+	const Bus::MMIO& handler = debugger.originalMMIO[page];
+	if(original.write)
+	{
+		original.write[address & 0xFF] = value;
+		debugger.bus.markDirty(address);
+	}
+	else if(handler.write)
+		handler.write(handler.context,address,value);
+
+	if(debugger.isWatched(address,debugger.writeWatch)) debugger.hit(address,WRITE,value);
+}
@@ -0,0 +1,89 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+#include "../Utils/handler.h"
+#include "../Bus/Bus.h"
+
+/*
+
+    DEBUGGER
+
+    Execution breakpoints and memory read/write watchpoints, one bit per address each.
+    Attached with CPU::setDebugger(), run() then stops with STOP_REASON::BREAKPOINT before
+    executing a breakpoint and with STOP_REASON::WATCHPOINT after the instruction that touched
+    a watched address. CPU::tick() steps past a breakpoint.
+
+    Breakpoints are checked by the debug policy of the CPU run loop, runs without a Debugger
+    use the policy that checks nothing. Watchpoints cost nothing on pages without one:
+    a page holding a watched address is hooked on the Bus, its accesses go through
+    the MMIO path of the CPU into this class, which checks the bitmap and forwards them.
+    The RAM under a hooked page stays the Bus backing page, so save states and rewind copy it
+    as before. The block cache does not see it as RAM, set watchpoints after mapping memory
+    and remove them before remapping.
+
+*/
+
+class Debugger
+{
+    public:
+        enum ACCESS : uint8_t { READ = 1, WRITE = 2 };
+
+        struct HIT // first watched access since the last run() started
+        {
+            ADDRESS address;
+            ACCESS access;
+            BYTE value; // read or written
+        };
+
+        explicit Debugger(Bus& bus);
+
+        ~Debugger(); // hooked pages get their mapping back
+
+        Debugger(const Debugger&) = delete;
+
+        void setBreakpoint(ADDRESS address,bool enabled = true);
+
+        void setWatchpoint(ADDRESS first,ADDRESS last,uint8_t access); // READ | WRITE, 0 removes
+
+        void clear(); // every breakpoint and watchpoint
+
+        bool isBreakpoint(ADDRESS address) const { return breakpoints[address >> 6] & (1ULL << (address & 63)); }
+
+        bool hasBreakpointIn(ADDRESS start,ADDRESS end) const; // any breakpoint in [start,end), wrapping past $FFFF
+
+        bool takeHit() // true once per watched access, cleared by reading it
+        {
+            bool pending = hitPending;
+            hitPending = false;
+            return pending;
+        }
+
+        const HIT& getLastHit() const { return lastHit; }
+
+    private:
+        Bus& bus;
+
+        uint64_t breakpoints[1024] = {};
+        uint64_t readWatch[1024] = {};
+        uint64_t writeWatch[1024] = {};
+
+        /* HOOKED PAGES */
+        bool hooked[256] = {};
+        Bus::PAGE originalPage[256];
+        Bus::MMIO originalMMIO[256];
+
+        HIT lastHit = { 0,READ,0 };
+        bool hitPending = false;
+
+        bool isWatched(ADDRESS address,const uint64_t* bitmap) const { return bitmap[address >> 6] & (1ULL << (address & 63)); }
+
+        void updateHook(uint8_t page); // hook or unhook page to match the watch bitmaps
+
+        void hit(ADDRESS address,ACCESS access,BYTE value);
+
+        static BYTE onRead(void* context,ADDRESS address);
+
+        static void onWrite(void* context,ADDRESS address,BYTE value);
+};
+
+
+#endif
@@ -0,0 +1,578 @@
+#include "JIT.h"
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if JIT_SUPPORTED
+
+#include <sys/mman.h>
+
+namespace
+{
+	/*------------x86-64 ENCODING------------*/
+	enum REG { RAX,RCX,RDX,RBX,RSP,RBP,RSI,RDI,R8,R9,R10,R11,R12 };
+
+	enum ALU : uint8_t { ADD = 0x01,OR = 0x09,AND = 0x21,SUB = 0x29,XOR = 0x31,CMP = 0x39,TEST = 0x85 };
+
+	enum CONDITION : uint8_t { CC_B = 0x2,CC_AE = 0x3,CC_E = 0x4,CC_NE = 0x5 };
+
+	// Guest state lives in these for the whole block, RAX, RBX and R12 are scratch
+	const REG REG_CONTEXT = RDI;
+	const REG REG_A = R8,REG_X = R9,REG_Y = R10,REG_SP = R11;
+	const REG REG_P = RSI,REG_NZ = RDX;
+
+	const uint8_t CARRY_FLAG = 1 << CARRY_BIT;
+	const uint8_t DECIMAL_FLAG = 1 << DECIMAL_MODE_BIT;
+	const uint8_t OVERFLOW_FLAG = 1 << OVERFLOW_BIT;
+
+	class Emitter
+	{
+		public:
+			std::vector<uint8_t> code;
+
+			size_t label() { labels.push_back(0); return labels.size() - 1; }
+
+			void bind(size_t label) { labels[label] = code.size(); }
+
+			void jcc(CONDITION condition,size_t label) { byte(0x0F); byte(0x80 | condition); fixup(label); }
+
+			void jmp(size_t label) { byte(0xE9); fixup(label); }
+
+			void link() // resolve rel32 of every jump
+			{
+				for(auto& f : fixups)
+				{
+					int32_t rel = (int32_t)(labels[f.second] - (f.first + 4));
+					std::memcpy(&code[f.first],&rel,4);
+				}
+			}
+
+			void byte(uint8_t b) { code.push_back(b); }
+			void dword(uint32_t d) { for(int i = 0;i < 4;i++) byte(d >> (i * 8)); }
+			void qword(uint64_t q) { for(int i = 0;i < 8;i++) byte(q >> (i * 8)); }
+
+			void push(REG r) { if(r >= R8) byte(0x41); byte(0x50 | (r & 7)); }
+			void pop(REG r) { if(r >= R8) byte(0x41); byte(0x58 | (r & 7)); }
+			void ret() { byte(0xC3); }
+
+			void movImm(REG dst,uint32_t imm) { rex(false,0,0,dst); byte(0xB8 | (dst & 7)); dword(imm); }
+			void movImm64(REG dst,uint64_t imm) { rex(true,0,0,dst); byte(0xB8 | (dst & 7)); qword(imm); }
+			void mov(REG dst,REG src) { alu((ALU)0x89,dst,src); }
+
+			void alu(ALU op,REG dst,REG src) { rex(false,src,0,dst); byte(op); modrm(3,src,dst); }
+			void aluImm(ALU op,REG dst,uint32_t imm) { rex(false,0,0,dst); byte(0x81); modrm(3,op >> 3,dst); dword(imm); } // /digit is op >> 3
+			void testImm(REG dst,uint32_t imm) { rex(false,0,0,dst); byte(0xF7); modrm(3,0,dst); dword(imm); }
+			void shl(REG dst,uint8_t n) { rex(false,0,0,dst); byte(0xC1); modrm(3,4,dst); byte(n); }
+			void shr(REG dst,uint8_t n) { rex(false,0,0,dst); byte(0xC1); modrm(3,5,dst); byte(n); }
+			void notReg(REG dst) { rex(false,0,0,dst); byte(0xF7); modrm(3,2,dst); }
+			void setcc(CONDITION condition,REG dst) { rex(false,0,0,dst,true); byte(0x0F); byte(0x90 | condition); modrm(3,0,dst); }
+
+			// byte [RDI + offset] of CONTEXT
+			void loadContext(REG dst,uint8_t offset) { rex(false,dst,0,RDI); byte(0x0F); byte(0xB6); modrm(1,dst,RDI); byte(offset); }
+			void loadContextWord(REG dst,uint8_t offset) { rex(false,dst,0,RDI); byte(0x0F); byte(0xB7); modrm(1,dst,RDI); byte(offset); }
+			void storeContext(uint8_t offset,REG src) { rex(false,src,0,RDI,true); byte(0x88); modrm(1,src,RDI); byte(offset); }
+			void storeContextWord(uint8_t offset,REG src) { byte(0x66); rex(false,src,0,RDI); byte(0x89); modrm(1,src,RDI); byte(offset); }
+			void storeContextImm16(uint8_t offset,uint16_t imm) { byte(0x66); byte(0xC7); modrm(1,0,RDI); byte(offset); byte(imm); byte(imm >> 8); }
+			void addContextQword(uint8_t offset,uint32_t imm) { rex(true,0,0,RDI); byte(0x81); modrm(1,0,RDI); byte(offset); dword(imm); }
+			void testContext(uint8_t offset,uint8_t imm) { byte(0xF6); modrm(1,0,RDI); byte(offset); byte(imm); }
+
+			// byte at a host address, goes through RAX
+			void loadAbsolute(REG dst,const void* pointer) { movImm64(RAX,(uint64_t)pointer); rex(false,dst,0,RAX); byte(0x0F); byte(0xB6); modrm(0,dst,RAX); }
+			void storeAbsolute(const void* pointer,REG src) { movImm64(RAX,(uint64_t)pointer); rex(false,src,0,RAX,true); byte(0x88); modrm(0,src,RAX); }
+
+			// byte at host address + RAX, goes through R12
+			void loadIndexed(REG dst,const void* pointer) { movImm64(R12,(uint64_t)pointer); rex(false,dst,RAX,R12); byte(0x0F); byte(0xB6); modrm(0,dst,RSP); sib(RAX,R12); }
+			void storeIndexed(const void* pointer,REG src) { movImm64(R12,(uint64_t)pointer); rex(false,src,RAX,R12,true); byte(0x88); modrm(0,src,RSP); sib(RAX,R12); }
+
+			// bt/bts qword [pointer],bit through RAX
+			void bitTest(const void* pointer,uint8_t bit) { bitOp(4,pointer,bit); }
+			void bitSet(const void* pointer,uint8_t bit) { bitOp(5,pointer,bit); }
+
+		private:
+			std::vector<size_t> labels;
+			std::vector<std::pair<size_t,size_t>> fixups; // rel32 position,label
+
+			void fixup(size_t label) { fixups.push_back({ code.size(),label }); dword(0); }
+
+			void rex(bool wide,int reg,int index,int base,bool force = false)
+			{
+				uint8_t prefix = 0x40 | (wide << 3) | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3);
+				if(prefix != 0x40 || force) byte(prefix); // force selects SIL/DIL instead of DH/BH for byte registers
+			}
+
+			void modrm(int mod,int reg,int rm) { byte((mod << 6) | ((reg & 7) << 3) | (rm & 7)); }
+			void sib(int index,int base) { byte(((index & 7) << 3) | (base & 7)); }
+
+			void bitOp(int digit,const void* pointer,uint8_t bit) { movImm64(RAX,(uint64_t)pointer); rex(true,0,0,RAX); byte(0x0F); byte(0xBA); modrm(0,digit,RAX); byte(bit); }
+	};
+
+	/*------------TRANSLATOR------------*/
+	class Translator
+	{
+		public:
+			Translator(const Bus& bus,uint64_t* dirtyPages,const uint64_t* codePages,Variant variant) :
+				bus(bus),dirtyPages(dirtyPages),codePages(codePages),opcodes(opcodeTable(variant)),decimalMode(hasDecimalMode(variant)) { }
+
+			JIT::TRANSLATION translate(const JIT::INSTRUCTION* instructions,size_t count,std::vector<uint8_t>& out);
+
+		private:
+			struct OPERAND
+			{
+				enum KIND { VALUE,POINTER,ZERO_PAGE_INDEXED } kind;
+				uint8_t value;   // VALUE: immediate, ZERO_PAGE_INDEXED: zero page base
+				BYTE* pointer;   // POINTER: the byte, ZERO_PAGE_INDEXED: start of page 0
+				uint8_t page;
+				REG index;
+			};
+
+			struct EXIT_STUB
+			{
+				size_t label;
+				ADDRESS programCounter;
+				uint32_t cycles;
+				uint32_t status;
+			};
+
+			const Bus& bus;
+			uint64_t* dirtyPages;
+			const uint64_t* codePages;
+			const std::array<OPCODE,256>& opcodes;
+			bool decimalMode; // ADC and SBC depend on D
+
+			Emitter emit;
+			std::vector<EXIT_STUB> stubs;
+			JIT::TRANSLATION result;
+			size_t epilogue;
+			uint32_t position = 0; // index of the instruction being translated
+
+			bool resolve(AddrMode mode,ADDRESS operand,bool forWrite,OPERAND& out);
+			bool translateInstruction(const JIT::INSTRUCTION& instruction,uint32_t cycles,bool& ends);
+
+			void load(const OPERAND& operand); // operand -> RAX
+			void store(const OPERAND& operand,REG src,ADDRESS nextPC,uint32_t cycles);
+			void setFlags(uint8_t mask,REG value); // P = (P & ~mask) | value
+			void exit(ADDRESS programCounter,uint32_t cycles,uint32_t status); // inline exit
+			size_t exitStub(ADDRESS programCounter,uint32_t cycles,uint32_t status); // label of an out of line exit
+	};
+
+	bool Translator::resolve(AddrMode mode,ADDRESS operand,bool forWrite,OPERAND& out)
+	{
+		switch(mode)
+		{
+			case AddrMode::IMM:
+			{
+				if(forWrite) return false;
+				const BYTE* page = bus.getPage(operand).read;
+				if(!page) return false;
+				out.kind = OPERAND::VALUE;
+				out.value = page[operand & 0xFF];
+				return true;
+			}
+			case AddrMode::ZER:
+			case AddrMode::ABS:
+			{
+				// Pointers are fixed at translation, a remap flushes every translation
+				BYTE* page = forWrite ? bus.getPage(operand).write : bus.getPage(operand).read;
+				if(!page) return false; // MMIO, left to the interpreter
+				out.kind = OPERAND::POINTER;
+				out.pointer = page + (operand & 0xFF);
+				out.page = operand >> 8;
+				return true;
+			}
+			case AddrMode::ZEX:
+			case AddrMode::ZEY:
+			{
+				BYTE* page = forWrite ? bus.getPage(0).write : bus.getPage(0).read;
+				if(!page) return false;
+				out.kind = OPERAND::ZERO_PAGE_INDEXED;
+				out.value = operand;
+				out.pointer = page;
+				out.page = 0;
+				out.index = mode == AddrMode::ZEX ? REG_X : REG_Y;
+				return true;
+			}
+			default:
+				return false;
+		}
+	}
+
+	void Translator::load(const OPERAND& operand)
+	{
+		switch(operand.kind)
+		{
+			case OPERAND::VALUE: emit.movImm(RAX,operand.value); break;
+			case OPERAND::POINTER: emit.loadAbsolute(RAX,operand.pointer); break;
+			case OPERAND::ZERO_PAGE_INDEXED:
+				emit.mov(RAX,operand.index);
+				emit.aluImm(ADD,RAX,operand.value);
+				emit.aluImm(AND,RAX,0xFF); // wraps inside zero page
+				emit.loadIndexed(RAX,operand.pointer);
+				break;
+		}
+	}
+
+	void Translator::store(const OPERAND& operand,REG src,ADDRESS nextPC,uint32_t cycles)
+	{
+		if(operand.kind == OPERAND::POINTER)
+			emit.storeAbsolute(operand.pointer,src);
+		else
+		{
+			emit.mov(RAX,operand.index);
+			emit.aluImm(ADD,RAX,operand.value);
+			emit.aluImm(AND,RAX,0xFF);
+			emit.storeIndexed(operand.pointer,src);
+		}
+
+		uint8_t page = operand.page;
+		emit.bitSet(&dirtyPages[page >> 6],page & 63);
+		emit.bitTest(&codePages[page >> 6],page & 63); // self-modifying code leaves the block
+		emit.jcc(CC_B,exitStub(nextPC,cycles,JIT::EXIT_CODE_WRITE | page | (position + 1) << 16));
+
+		result.writePages[page >> 6] |= 1ULL << (page & 63);
+	}
+
+	void Translator::setFlags(uint8_t mask,REG value)
+	{
+		emit.aluImm(AND,REG_P,(uint8_t)~mask);
+		emit.alu(OR,REG_P,value);
+	}
+
+	void Translator::exit(ADDRESS programCounter,uint32_t cycles,uint32_t status)
+	{
+		emit.storeContextImm16(offsetof(JIT::CONTEXT,programCounter),programCounter);
+		emit.addContextQword(offsetof(JIT::CONTEXT,currentCycle),cycles);
+		emit.movImm(RAX,status);
+		emit.jmp(epilogue);
+	}
+
+	size_t Translator::exitStub(ADDRESS programCounter,uint32_t cycles,uint32_t status)
+	{
+		size_t label = emit.label();
+		stubs.push_back({ label,programCounter,cycles,status });
+		return label;
+	}
+
+	bool Translator::translateInstruction(const JIT::INSTRUCTION& instruction,uint32_t cycles,bool& ends)
+	{
+		const OPCODE& info = opcodes[instruction.opcode];
+		OPERAND operand;
+		REG reg;
+
+		switch(info.operation)
+		{
+			/*------LOADS AND ALU------*/
+			case Mnemonic::LDA: case Mnemonic::LDX: case Mnemonic::LDY:
+				if(!resolve(info.addr,instruction.operand,false,operand)) return false;
+				reg = info.operation == Mnemonic::LDA ? REG_A : info.operation == Mnemonic::LDX ? REG_X : REG_Y;
+				load(operand);
+				emit.mov(reg,RAX);
+				emit.mov(REG_NZ,reg);
+				return true;
+
+			case Mnemonic::AND: case Mnemonic::ORA: case Mnemonic::EOR:
+				if(!resolve(info.addr,instruction.operand,false,operand)) return false;
+				load(operand);
+				emit.alu(info.operation == Mnemonic::AND ? AND : info.operation == Mnemonic::ORA ? OR : XOR,REG_A,RAX);
+				emit.mov(REG_NZ,REG_A);
+				return true;
+
+			case Mnemonic::BIT:
+				if(!resolve(info.addr,instruction.operand,false,operand)) return false;
+				load(operand);
+				emit.mov(RBX,RAX);
+				emit.aluImm(AND,RBX,OVERFLOW_FLAG);
+				setFlags(OVERFLOW_FLAG,RBX);
+				emit.mov(RBX,RAX);
+				emit.aluImm(AND,RBX,0x80);
+				emit.shl(RBX,8);
+				emit.alu(AND,RAX,REG_A);
+				emit.alu(OR,RAX,RBX);
+				emit.mov(REG_NZ,RAX);
+				return true;
+
+			case Mnemonic::CMP: case Mnemonic::CPX: case Mnemonic::CPY:
+				if(!resolve(info.addr,instruction.operand,false,operand)) return false;
+				reg = info.operation == Mnemonic::CMP ? REG_A : info.operation == Mnemonic::CPX ? REG_X : REG_Y;
+				load(operand);
+				emit.mov(REG_NZ,reg);
+				emit.alu(SUB,REG_NZ,RAX);
+				emit.aluImm(AND,REG_NZ,0xFF);
+				emit.alu(XOR,RBX,RBX);
+				emit.alu(CMP,reg,RAX);
+				emit.setcc(CC_AE,RBX);
+				setFlags(CARRY_FLAG,RBX);
+				return true;
+
+			case Mnemonic::ADC: // binary mode only, the block is declined when DECIMAL is set
+				if(!resolve(info.addr,instruction.operand,false,operand)) return false;
+				load(operand);
+				emit.mov(R12,REG_P);
+				emit.aluImm(AND,R12,CARRY_FLAG);
+				emit.alu(ADD,R12,RAX);
+				emit.alu(ADD,R12,REG_A);    // R12 = temp
+				emit.mov(RBX,REG_A);
+				emit.alu(XOR,RBX,RAX);
+				emit.notReg(RBX);           // ~(A ^ data)
+				emit.mov(RAX,REG_A);
+				emit.alu(XOR,RAX,R12);      // (A ^ temp)
+				emit.alu(AND,RBX,RAX);
+				emit.aluImm(AND,RBX,0x80);
+				emit.shr(RBX,7 - OVERFLOW_BIT);
+				emit.mov(RAX,R12);
+				emit.shr(RAX,8);            // temp > 0xFF
+				emit.alu(OR,RBX,RAX);
+				setFlags(CARRY_FLAG | OVERFLOW_FLAG,RBX);
+				emit.mov(REG_A,R12);
+				emit.aluImm(AND,REG_A,0xFF);
+				emit.mov(REG_NZ,REG_A);
+				return true;
+
+			case Mnemonic::SBC:
+				if(!resolve(info.addr,instruction.operand,false,operand)) return false;
+				load(operand);
+				emit.mov(R12,REG_P);
+				emit.aluImm(AND,R12,CARRY_FLAG);
+				emit.aluImm(XOR,R12,1);     // borrow
+				emit.mov(RBX,REG_A);
+				emit.alu(SUB,RBX,RAX);
+				emit.alu(SUB,RBX,R12);      // RBX = temp, wraps like the uint32_t of the interpreter
+				emit.mov(R12,REG_A);
+				emit.alu(XOR,R12,RBX);      // (A ^ temp)
+				emit.alu(XOR,RAX,REG_A);    // (A ^ data)
+				emit.alu(AND,R12,RAX);
+				emit.aluImm(AND,R12,0x80);
+				emit.shr(R12,7 - OVERFLOW_BIT);
+				emit.alu(XOR,RAX,RAX);
+				emit.aluImm(CMP,RBX,0x100);
+				emit.setcc(CC_B,RAX);       // temp < 0x100
+				emit.alu(OR,R12,RAX);
+				setFlags(CARRY_FLAG | OVERFLOW_FLAG,R12);
+				emit.mov(REG_A,RBX);
+				emit.aluImm(AND,REG_A,0xFF);
+				emit.mov(REG_NZ,REG_A);
+				return true;
+
+			/*------STORES------*/
+			case Mnemonic::STA: case Mnemonic::STX: case Mnemonic::STY:
+				if(!resolve(info.addr,instruction.operand,true,operand)) return false;
+				reg = info.operation == Mnemonic::STA ? REG_A : info.operation == Mnemonic::STX ? REG_X : REG_Y;
+				store(operand,reg,instruction.nextPC,cycles);
+				return true;
+
+			/*------REGISTERS AND FLAGS------*/
+			case Mnemonic::TAX: emit.mov(REG_X,REG_A); emit.mov(REG_NZ,REG_X); return true;
+			case Mnemonic::TAY: emit.mov(REG_Y,REG_A); emit.mov(REG_NZ,REG_Y); return true;
+			case Mnemonic::TXA: emit.mov(REG_A,REG_X); emit.mov(REG_NZ,REG_A); return true;
+			case Mnemonic::TYA: emit.mov(REG_A,REG_Y); emit.mov(REG_NZ,REG_A); return true;
+			case Mnemonic::TSX: emit.mov(REG_X,REG_SP); emit.mov(REG_NZ,REG_X); return true;
+			case Mnemonic::TXS: emit.mov(REG_SP,REG_X); return true;
+
+			case Mnemonic::INX_OP: case Mnemonic::INY_OP: case Mnemonic::DEX: case Mnemonic::DEY:
+				reg = (info.operation == Mnemonic::INX_OP || info.operation == Mnemonic::DEX) ? REG_X : REG_Y;
+				if(info.operation == Mnemonic::INX_OP || info.operation == Mnemonic::INY_OP)
+					emit.aluImm(ADD,reg,1);
+				else
+					emit.aluImm(SUB,reg,1);
+				emit.aluImm(AND,reg,0xFF);
+				emit.mov(REG_NZ,reg);
+				return true;
+
+			case Mnemonic::ASL_ACC: case Mnemonic::ROL_ACC:
+				emit.mov(R12,REG_A);
+				emit.shr(R12,7);            // new carry
+				emit.shl(REG_A,1);
+				if(info.operation == Mnemonic::ROL_ACC)
+				{
+					emit.mov(RBX,REG_P);
+					emit.aluImm(AND,RBX,CARRY_FLAG);
+					emit.alu(OR,REG_A,RBX);
+				}
+				emit.aluImm(AND,REG_A,0xFF);
+				setFlags(CARRY_FLAG,R12);
+				emit.mov(REG_NZ,REG_A);
+				return true;
+
+			case Mnemonic::LSR_ACC: case Mnemonic::ROR_ACC:
+				emit.mov(R12,REG_A);
+				emit.aluImm(AND,R12,0x01);  // new carry
+				emit.shr(REG_A,1);
+				if(info.operation == Mnemonic::ROR_ACC)
+				{
+					emit.mov(RBX,REG_P);
+					emit.aluImm(AND,RBX,CARRY_FLAG);
+					emit.shl(RBX,7);
+					emit.alu(OR,REG_A,RBX);
+				}
+				setFlags(CARRY_FLAG,R12);
+				emit.mov(REG_NZ,REG_A);
+				return true;
+
+			case Mnemonic::CLC: emit.aluImm(AND,REG_P,(uint8_t)~CARRY_FLAG); return true;
+			case Mnemonic::SEC: emit.aluImm(OR,REG_P,CARRY_FLAG); return true;
+			case Mnemonic::CLV: emit.aluImm(AND,REG_P,(uint8_t)~OVERFLOW_FLAG); return true;
+			case Mnemonic::NOP: return true;
+
+			/*------CONTROL FLOW------*/
+			case Mnemonic::BCC: case Mnemonic::BCS: case Mnemonic::BEQ: case Mnemonic::BNE:
+			case Mnemonic::BMI: case Mnemonic::BPL: case Mnemonic::BVC: case Mnemonic::BVS:
+			{
+				Mnemonic operation = info.operation;
+				if(operation == Mnemonic::BCC || operation == Mnemonic::BCS)
+					emit.testImm(REG_P,CARRY_FLAG);
+				else if(operation == Mnemonic::BVC || operation == Mnemonic::BVS)
+					emit.testImm(REG_P,OVERFLOW_FLAG);
+				else if(operation == Mnemonic::BEQ || operation == Mnemonic::BNE)
+					emit.testImm(REG_NZ,0xFF); // host ZF is the guest Z
+				else
+				{
+					emit.mov(RAX,REG_NZ);
+					emit.shr(RAX,8);
+					emit.alu(OR,RAX,REG_NZ);
+					emit.testImm(RAX,0x80);
+				}
+
+				// BCC/BVC/BPL branch when the tested bits are clear, BEQ when the low byte of nz is 0
+				bool takenOnHostZero = operation == Mnemonic::BCC || operation == Mnemonic::BVC ||
+									   operation == Mnemonic::BPL || operation == Mnemonic::BEQ;
+				uint32_t takenCycles = cycles + 1 + ((instruction.nextPC ^ instruction.operand) > 0xFF); // both ends are known here
+				emit.jcc(takenOnHostZero ? CC_E : CC_NE,exitStub(instruction.operand,takenCycles,JIT::EXIT_DONE));
+				exit(instruction.nextPC,cycles,JIT::EXIT_DONE);
+				ends = true;
+				return true;
+			}
+
+			case Mnemonic::JMP:
+				if(info.addr != AddrMode::ABS) return false;
+				exit(instruction.operand,cycles,JIT::EXIT_DONE);
+				ends = true;
+				return true;
+
+			default:
+				return false;
+		}
+	}
+
+	JIT::TRANSLATION Translator::translate(const JIT::INSTRUCTION* instructions,size_t count,std::vector<uint8_t>& out)
+	{
+		epilogue = emit.label();
+		size_t declined = emit.label();
+
+		bool decimalSensitive = false;
+		for(size_t i = 0;i < count && decimalMode;i++) // RP2A03 blocks never check D
+		{
+			Mnemonic operation = opcodes[instructions[i].opcode].operation;
+			decimalSensitive |= operation == Mnemonic::ADC || operation == Mnemonic::SBC;
+		}
+
+		emit.push(RBX);
+		emit.push(R12);
+		if(decimalSensitive)
+		{
+			emit.testContext(offsetof(JIT::CONTEXT,P),DECIMAL_FLAG);
+			emit.jcc(CC_NE,declined);
+		}
+
+		emit.loadContext(REG_A,offsetof(JIT::CONTEXT,A));
+		emit.loadContext(REG_X,offsetof(JIT::CONTEXT,X));
+		emit.loadContext(REG_Y,offsetof(JIT::CONTEXT,Y));
+		emit.loadContext(REG_SP,offsetof(JIT::CONTEXT,SP));
+		emit.loadContext(REG_P,offsetof(JIT::CONTEXT,P));
+		emit.loadContextWord(REG_NZ,offsetof(JIT::CONTEXT,nz));
+
+		uint32_t cycles = 0;
+		bool ends = false;
+		size_t translated = 0;
+		while(translated < count && !ends)
+		{
+			const JIT::INSTRUCTION& instruction = instructions[translated];
+			position = translated;
+			uint32_t total = cycles + opcodes[instruction.opcode].cycles; // interpreter counts cycles before the operation
+			if(!translateInstruction(instruction,total,ends)) break;
+			cycles = total;
+			translated++;
+		}
+
+		if(!translated) return result;
+
+		if(!ends)
+			exit(instructions[translated - 1].nextPC,cycles,JIT::EXIT_DONE); // interpreter takes over here
+
+		emit.bind(epilogue);
+		emit.storeContext(offsetof(JIT::CONTEXT,A),REG_A);
+		emit.storeContext(offsetof(JIT::CONTEXT,X),REG_X);
+		emit.storeContext(offsetof(JIT::CONTEXT,Y),REG_Y);
+		emit.storeContext(offsetof(JIT::CONTEXT,SP),REG_SP);
+		emit.storeContext(offsetof(JIT::CONTEXT,P),REG_P);
+		emit.storeContextWord(offsetof(JIT::CONTEXT,nz),REG_NZ);
+		emit.pop(R12);
+		emit.pop(RBX);
+		emit.ret();
+
+		emit.bind(declined);
+		emit.movImm(RAX,JIT::EXIT_DECLINED);
+		emit.pop(R12);
+		emit.pop(RBX);
+		emit.ret();
+
+		for(const EXIT_STUB& stub : stubs)
+		{
+			emit.bind(stub.label);
+			exit(stub.programCounter,stub.cycles,stub.status);
+		}
+
+		emit.link();
+		out.swap(emit.code);
+		result.count = translated;
+		return result;
+	}
+}
+
+JIT::JIT(uint64_t* dirtyPages,const uint64_t* codePages,Variant variant) : dirtyPages(dirtyPages),codePages(codePages),variant(variant)
+{
+	void* memory = mmap(nullptr,CODE_SIZE,PROT_READ | PROT_EXEC,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+	if(memory == MAP_FAILED) return; // CPU falls back to the block cache
+	code = static_cast<uint8_t*>(memory);
+	capacity = CODE_SIZE;
+}
+
+JIT::~JIT()
+{
+	if(code) munmap(code,capacity);
+}
+
+void JIT::reset()
+{
+	used = 0;
+}
+
+JIT::TRANSLATION JIT::translate(const INSTRUCTION* instructions,size_t count,const Bus& bus)
+{
+	std::vector<uint8_t> native;
+	TRANSLATION translation = Translator(bus,dirtyPages,codePages,variant).translate(instructions,count,native);
+	if(!translation.count || !code || native.size() > capacity - used) return TRANSLATION();
+
+	// Buffer is writable only while copying, never writable and executable at once
+	if(mprotect(code,capacity,PROT_READ | PROT_WRITE)) return TRANSLATION();
+	std::memcpy(code + used,native.data(),native.size());
+	mprotect(code,capacity,PROT_READ | PROT_EXEC);
+	__builtin___clear_cache((char*)code + used,(char*)code + used + native.size());
+
+	translation.code = reinterpret_cast<NATIVE_BLOCK>(code + used);
+	used += (native.size() + 15) & ~(size_t)15;
+	return translation;
+}
+
+#else
+
+JIT::JIT(uint64_t* dirtyPages,const uint64_t* codePages,Variant variant) : dirtyPages(dirtyPages),codePages(codePages),variant(variant) { }
+
+JIT::~JIT() { }
+
+void JIT::reset() { }
+
+JIT::TRANSLATION JIT::translate(const INSTRUCTION* instructions,size_t count,const Bus& bus)
+{
+	return TRANSLATION(); // no code generator for this host, everything stays interpreted
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "../Utils/handler.h"
+#include "../Bus/Bus.h"
+#include "Opcodes.h"
+
+/*
+
+    DYNAMIC RECOMPILER (x86-64 Linux only)
+
+    Translates a decoded block of the block cache into native code.
+    A,X,Y,SP, P and the lazy N/Z result live in host registers while the block runs,
+    they are loaded from CONTEXT on entry and stored back on every exit.
+    Only loads/stores on host memory pages, register transfers, increments,
+    AND/ORA/EOR/BIT, compares, binary mode ADC/SBC, shifts of A, flag ops, branches and JMP are translated
+    (OPCODEs as the Variant of the CPU decodes them, RP2A03 blocks skip the decimal mode check),
+    translation stops at the first other instruction (or at any MMIO access) and
+    the interpreter continues from there.
+    P and nz get exactly the values the interpreter gives them, so results are bit for bit the same.
+    Writes mark the Bus dirty bitmap and leave the block when they hit a page holding decoded code.
+
+    Generated code is never freed one block at a time, reset() drops all of it.
+
+*/
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+class JIT
+{
+    public:
+        struct CONTEXT // registers handed to generated code, copied in and out of CPU
+        {
+            uint8_t A,X,Y,SP;
+            uint8_t P;   // C,I,D,V as CPU keeps them
+            uint16_t nz; // N and Z source, see CPU FLAGS
+            ADDRESS programCounter;
+            uint64_t currentCycle;
+        };
+
+        using NATIVE_BLOCK = uint32_t (*)(CONTEXT* context); // returns one of EXIT
+
+        enum EXIT : uint32_t
+        {
+            EXIT_DONE = 0,          // ran to the end of the translated instructions (or a branch left them)
+            EXIT_DECLINED = 1,      // nothing ran, decimal mode ADC/SBC has to be interpreted
+            EXIT_CODE_WRITE = 0x100 // | page | instructions run << 16, a write hit decoded code, invalidate page and leave the block
+        };
+
+        struct INSTRUCTION // one decoded instruction, operand as the block cache stores it
+        {
+            uint8_t opcode;
+            ADDRESS operand; // IMM: address of the value, REL: branch target
+            ADDRESS nextPC;
+        };
+
+        struct TRANSLATION
+        {
+            NATIVE_BLOCK code = nullptr; // nullptr if not even the first instruction could be translated
+            uint8_t count = 0; // leading instructions covered by code
+            uint64_t writePages[4] = { 0,0,0,0 }; // bit per page code may write
+        };
+
+        JIT(uint64_t* dirtyPages,const uint64_t* codePages,Variant variant); // bitmaps generated code updates and checks
+
+        ~JIT();
+
+        JIT(const JIT&) = delete;
+
+        bool isAvailable() const { return code != nullptr; } // false on other hosts or if no executable memory
+
+        bool isFull() const { return capacity - used < MAX_TRANSLATION_SIZE; } // reset() before translating again
+
+        void reset(); // every NATIVE_BLOCK handed out is invalid afterwards
+
+        TRANSLATION translate(const INSTRUCTION* instructions,size_t count,const Bus& bus);
+
+    private:
+        static const size_t CODE_SIZE = 4 << 20;
+        static const size_t MAX_TRANSLATION_SIZE = 16 << 10; // a 32 instruction block stays far below this
+
+        uint8_t* code = nullptr;
+        size_t capacity = 0;
+        size_t used = 0;
+
+        uint64_t* dirtyPages;
+        const uint64_t* codePages;
+        Variant variant;
+};
+
+
+#endif
@@ -0,0 +1,425 @@
+#ifndef OPCODES_H
+#define OPCODES_H
+
+#include "../Utils/handler.h"
+#include <array>
+
+/*
+
+    OPCODE TABLE
+
+    Every OPCODE of the 6502 is described here once as constexpr data:
+    the operation (Mnemonic), the addressing mode (AddrMode) and the cycle count.
+    CPU expands this table with templates into one specialized handler per OPCODE,
+    so nothing is filled at runtime and cycle counts are folded by the compiler.
+    OPCODEs that are not listed stay ILLEGAL.
+
+    There is one table per Variant. NMOS and RP2A03 share the OPCODEs of the 6502, CMOS (65C02)
+    adds its own and turns every undefined OPCODE into a NOP. The traits below tell CPU what else
+    differs, all of it is known at compile time.
+
+    Cycle counts are the ones of the fastest case. Reads through ABX, ABY and INY take one more
+    cycle when the index carries into the next page (addsPageCrossCycle()), a taken branch takes
+    one more and another one if it lands on a different page than the next instruction.
+
+*/
+
+enum class Variant : uint8_t
+{
+    NMOS,   // MOS 6502
+    RP2A03, // NES CPU, a 6502 without decimal mode, D is a flag and nothing else
+    CMOS    // 65C02 (without the Rockwell bit instructions, WAI and STP)
+};
+
+static const size_t VARIANT_COUNT = 3;
+
+constexpr bool hasDecimalMode(Variant variant) { return variant != Variant::RP2A03; }
+
+constexpr bool hasIndirectJumpBug(Variant variant) { return variant != Variant::CMOS; } // JMP ($xxFF) takes the high byte from $xx00
+
+constexpr bool clearsDecimalOnInterrupt(Variant variant) { return variant == Variant::CMOS; } // BRK, IRQ and NMI
+
+constexpr bool addsDecimalCycle(Variant variant) { return variant == Variant::CMOS; } // ADC and SBC with D set, N and Z are valid
+
+enum class AddrMode : uint8_t
+{
+    ACC,IMM,ABS,ZER,ZEX,ZEY,ABX,ABY,IMP,REL,INX,INY,ABI,
+    ZPI,AIX // 65C02: (zp) and JMP (abs,X)
+};
+
+enum class Mnemonic : uint8_t
+{
+    ADC,AND,ASL,ASL_ACC,BCC,BCS,BEQ,BIT,BMI,BNE,
+    BPL,BRK,BVC,BVS,CLC,CLD,CLI,CLV,CMP,CPX,
+    CPY,DEC,DEX,DEY,EOR,INC,INX_OP,INY_OP,JMP,JSR,
+    LDA,LDX,LDY,LSR,LSR_ACC,NOP,ORA,PHA,PHP,PLA,
+    PLP,ROL,ROL_ACC,ROR,ROR_ACC,RTI,RTS,SBC,SEC,SED,
+    SEI,STA,STX,STY,TAX,TAY,TSX,TXA,TXS,TYA,
+    BIT_IMM,BRA,DEC_ACC,INC_ACC,PHX,PHY,PLX,PLY,STZ,TRB,
+    TSB, // BIT_IMM .. TSB are 65C02 only
+    JAM,ILLEGAL
+};
+
+struct OPCODE
+{
+    Mnemonic operation;
+    AddrMode addr;
+    uint8_t cycles; // without page crossing and taken branch cycles
+};
+
+constexpr std::array<OPCODE,256> makeOpcodeTable(Variant variant)
+{
+    std::array<OPCODE,256> table{};
+
+    // Fill with ILLEGAL for empty OPCODES
+    for(int i = 0;i < 256;i++)
+        table[i] = { Mnemonic::ILLEGAL,AddrMode::IMP,0 };
+
+    // Fill table now
+    table[0x69] = { Mnemonic::ADC,AddrMode::IMM,2 };
+    table[0x6D] = { Mnemonic::ADC,AddrMode::ABS,4 };
+    table[0x65] = { Mnemonic::ADC,AddrMode::ZER,3 };
+    table[0x61] = { Mnemonic::ADC,AddrMode::INX,6 };
+    table[0x71] = { Mnemonic::ADC,AddrMode::INY,5 };
+    table[0x75] = { Mnemonic::ADC,AddrMode::ZEX,4 };
+    table[0x7D] = { Mnemonic::ADC,AddrMode::ABX,4 };
+    table[0x79] = { Mnemonic::ADC,AddrMode::ABY,4 };
+
+    table[0x29] = { Mnemonic::AND,AddrMode::IMM,2 };
+    table[0x2D] = { Mnemonic::AND,AddrMode::ABS,4 };
+    table[0x25] = { Mnemonic::AND,AddrMode::ZER,3 };
+    table[0x21] = { Mnemonic::AND,AddrMode::INX,6 };
+    table[0x31] = { Mnemonic::AND,AddrMode::INY,5 };
+    table[0x35] = { Mnemonic::AND,AddrMode::ZEX,4 };
+    table[0x3D] = { Mnemonic::AND,AddrMode::ABX,4 };
+    table[0x39] = { Mnemonic::AND,AddrMode::ABY,4 };
+
+    table[0x0E] = { Mnemonic::ASL,AddrMode::ABS,6 };
+    table[0x06] = { Mnemonic::ASL,AddrMode::ZER,5 };
+    table[0x0A] = { Mnemonic::ASL_ACC,AddrMode::ACC,2 };
+    table[0x16] = { Mnemonic::ASL,AddrMode::ZEX,6 };
+    table[0x1E] = { Mnemonic::ASL,AddrMode::ABX,7 };
+
+    table[0x90] = { Mnemonic::BCC,AddrMode::REL,2 };
+
+    table[0xB0] = { Mnemonic::BCS,AddrMode::REL,2 };
+
+    table[0xF0] = { Mnemonic::BEQ,AddrMode::REL,2 };
+
+    table[0x2C] = { Mnemonic::BIT,AddrMode::ABS,4 };
+    table[0x24] = { Mnemonic::BIT,AddrMode::ZER,3 };
+
+    table[0x30] = { Mnemonic::BMI,AddrMode::REL,2 };
+
+    table[0xD0] = { Mnemonic::BNE,AddrMode::REL,2 };
+
+    table[0x10] = { Mnemonic::BPL,AddrMode::REL,2 };
+
+    table[0x00] = { Mnemonic::BRK,AddrMode::IMP,7 };
+
+    table[0x50] = { Mnemonic::BVC,AddrMode::REL,2 };
+
+    table[0x70] = { Mnemonic::BVS,AddrMode::REL,2 };
+
+    table[0x18] = { Mnemonic::CLC,AddrMode::IMP,2 };
+
+    table[0xD8] = { Mnemonic::CLD,AddrMode::IMP,2 };
+
+    table[0x58] = { Mnemonic::CLI,AddrMode::IMP,2 };
+
+    table[0xB8] = { Mnemonic::CLV,AddrMode::IMP,2 };
+
+    table[0xC9] = { Mnemonic::CMP,AddrMode::IMM,2 };
+    table[0xCD] = { Mnemonic::CMP,AddrMode::ABS,4 };
+    table[0xC5] = { Mnemonic::CMP,AddrMode::ZER,3 };
+    table[0xC1] = { Mnemonic::CMP,AddrMode::INX,6 };
+    table[0xD1] = { Mnemonic::CMP,AddrMode::INY,5 };
+    table[0xD5] = { Mnemonic::CMP,AddrMode::ZEX,4 };
+    table[0xDD] = { Mnemonic::CMP,AddrMode::ABX,4 };
+    table[0xD9] = { Mnemonic::CMP,AddrMode::ABY,4 };
+
+    table[0xE0] = { Mnemonic::CPX,AddrMode::IMM,2 };
+    table[0xEC] = { Mnemonic::CPX,AddrMode::ABS,4 };
+    table[0xE4] = { Mnemonic::CPX,AddrMode::ZER,3 };
+
+    table[0xC0] = { Mnemonic::CPY,AddrMode::IMM,2 };
+    table[0xCC] = { Mnemonic::CPY,AddrMode::ABS,4 };
+    table[0xC4] = { Mnemonic::CPY,AddrMode::ZER,3 };
+
+    table[0xCE] = { Mnemonic::DEC,AddrMode::ABS,6 };
+    table[0xC6] = { Mnemonic::DEC,AddrMode::ZER,5 };
+    table[0xD6] = { Mnemonic::DEC,AddrMode::ZEX,6 };
+    table[0xDE] = { Mnemonic::DEC,AddrMode::ABX,7 };
+
+    table[0xCA] = { Mnemonic::DEX,AddrMode::IMP,2 };
+
+    table[0x88] = { Mnemonic::DEY,AddrMode::IMP,2 };
+
+    table[0x49] = { Mnemonic::EOR,AddrMode::IMM,2 };
+    table[0x4D] = { Mnemonic::EOR,AddrMode::ABS,4 };
+    table[0x45] = { Mnemonic::EOR,AddrMode::ZER,3 };
+    table[0x41] = { Mnemonic::EOR,AddrMode::INX,6 };
+    table[0x51] = { Mnemonic::EOR,AddrMode::INY,5 };
+    table[0x55] = { Mnemonic::EOR,AddrMode::ZEX,4 };
+    table[0x5D] = { Mnemonic::EOR,AddrMode::ABX,4 };
+    table[0x59] = { Mnemonic::EOR,AddrMode::ABY,4 };
+
+    table[0xEE] = { Mnemonic::INC,AddrMode::ABS,6 };
+    table[0xE6] = { Mnemonic::INC,AddrMode::ZER,5 };
+    table[0xF6] = { Mnemonic::INC,AddrMode::ZEX,6 };
+    table[0xFE] = { Mnemonic::INC,AddrMode::ABX,7 };
+
+    table[0xE8] = { Mnemonic::INX_OP,AddrMode::IMP,2 };
+
+    table[0xC8] = { Mnemonic::INY_OP,AddrMode::IMP,2 };
+
+    table[0x4C] = { Mnemonic::JMP,AddrMode::ABS,3 };
+    table[0x6C] = { Mnemonic::JMP,AddrMode::ABI,5 };
+
+    table[0x20] = { Mnemonic::JSR,AddrMode::ABS,6 };
+
+    table[0xA9] = { Mnemonic::LDA,AddrMode::IMM,2 };
+    table[0xAD] = { Mnemonic::LDA,AddrMode::ABS,4 };
+    table[0xA5] = { Mnemonic::LDA,AddrMode::ZER,3 };
+    table[0xA1] = { Mnemonic::LDA,AddrMode::INX,6 };
+    table[0xB1] = { Mnemonic::LDA,AddrMode::INY,5 };
+    table[0xB5] = { Mnemonic::LDA,AddrMode::ZEX,4 };
+    table[0xBD] = { Mnemonic::LDA,AddrMode::ABX,4 };
+    table[0xB9] = { Mnemonic::LDA,AddrMode::ABY,4 };
+
+    table[0xA2] = { Mnemonic::LDX,AddrMode::IMM,2 };
+    table[0xAE] = { Mnemonic::LDX,AddrMode::ABS,4 };
+    table[0xA6] = { Mnemonic::LDX,AddrMode::ZER,3 };
+    table[0xBE] = { Mnemonic::LDX,AddrMode::ABY,4 };
+    table[0xB6] = { Mnemonic::LDX,AddrMode::ZEY,4 };
+
+    table[0xA0] = { Mnemonic::LDY,AddrMode::IMM,2 };
+    table[0xAC] = { Mnemonic::LDY,AddrMode::ABS,4 };
+    table[0xA4] = { Mnemonic::LDY,AddrMode::ZER,3 };
+    table[0xB4] = { Mnemonic::LDY,AddrMode::ZEX,4 };
+    table[0xBC] = { Mnemonic::LDY,AddrMode::ABX,4 };
+
+    table[0x4E] = { Mnemonic::LSR,AddrMode::ABS,6 };
+    table[0x46] = { Mnemonic::LSR,AddrMode::ZER,5 };
+    table[0x4A] = { Mnemonic::LSR_ACC,AddrMode::ACC,2 };
+    table[0x56] = { Mnemonic::LSR,AddrMode::ZEX,6 };
+    table[0x5E] = { Mnemonic::LSR,AddrMode::ABX,7 };
+
+    table[0xEA] = { Mnemonic::NOP,AddrMode::IMP,2 };
+
+    table[0x09] = { Mnemonic::ORA,AddrMode::IMM,2 };
+    table[0x0D] = { Mnemonic::ORA,AddrMode::ABS,4 };
+    table[0x05] = { Mnemonic::ORA,AddrMode::ZER,3 };
+    table[0x01] = { Mnemonic::ORA,AddrMode::INX,6 };
+    table[0x11] = { Mnemonic::ORA,AddrMode::INY,5 };
+    table[0x15] = { Mnemonic::ORA,AddrMode::ZEX,4 };
+    table[0x1D] = { Mnemonic::ORA,AddrMode::ABX,4 };
+    table[0x19] = { Mnemonic::ORA,AddrMode::ABY,4 };
+
+    table[0x48] = { Mnemonic::PHA,AddrMode::IMP,3 };
+
+    table[0x08] = { Mnemonic::PHP,AddrMode::IMP,3 };
+
+    table[0x68] = { Mnemonic::PLA,AddrMode::IMP,4 };
+
+    table[0x28] = { Mnemonic::PLP,AddrMode::IMP,4 };
+
+    table[0x2E] = { Mnemonic::ROL,AddrMode::ABS,6 };
+    table[0x26] = { Mnemonic::ROL,AddrMode::ZER,5 };
+    table[0x2A] = { Mnemonic::ROL_ACC,AddrMode::ACC,2 };
+    table[0x36] = { Mnemonic::ROL,AddrMode::ZEX,6 };
+    table[0x3E] = { Mnemonic::ROL,AddrMode::ABX,7 };
+
+    table[0x6E] = { Mnemonic::ROR,AddrMode::ABS,6 };
+    table[0x66] = { Mnemonic::ROR,AddrMode::ZER,5 };
+    table[0x6A] = { Mnemonic::ROR_ACC,AddrMode::ACC,2 };
+    table[0x76] = { Mnemonic::ROR,AddrMode::ZEX,6 };
+    table[0x7E] = { Mnemonic::ROR,AddrMode::ABX,7 };
+
+    table[0x40] = { Mnemonic::RTI,AddrMode::IMP,6 };
+
+    table[0x60] = { Mnemonic::RTS,AddrMode::IMP,6 };
+
+    table[0xE9] = { Mnemonic::SBC,AddrMode::IMM,2 };
+    table[0xED] = { Mnemonic::SBC,AddrMode::ABS,4 };
+    table[0xE5] = { Mnemonic::SBC,AddrMode::ZER,3 };
+    table[0xE1] = { Mnemonic::SBC,AddrMode::INX,6 };
+    table[0xF1] = { Mnemonic::SBC,AddrMode::INY,5 };
+    table[0xF5] = { Mnemonic::SBC,AddrMode::ZEX,4 };
+    table[0xFD] = { Mnemonic::SBC,AddrMode::ABX,4 };
+    table[0xF9] = { Mnemonic::SBC,AddrMode::ABY,4 };
+
+    table[0x38] = { Mnemonic::SEC,AddrMode::IMP,2 };
+
+    table[0xF8] = { Mnemonic::SED,AddrMode::IMP,2 };
+
+    table[0x78] = { Mnemonic::SEI,AddrMode::IMP,2 };
+
+    table[0x8D] = { Mnemonic::STA,AddrMode::ABS,4 };
+    table[0x85] = { Mnemonic::STA,AddrMode::ZER,3 };
+    table[0x81] = { Mnemonic::STA,AddrMode::INX,6 };
+    table[0x91] = { Mnemonic::STA,AddrMode::INY,6 };
+    table[0x95] = { Mnemonic::STA,AddrMode::ZEX,4 };
+    table[0x9D] = { Mnemonic::STA,AddrMode::ABX,5 };
+    table[0x99] = { Mnemonic::STA,AddrMode::ABY,5 };
+
+    table[0x8E] = { Mnemonic::STX,AddrMode::ABS,4 };
+    table[0x86] = { Mnemonic::STX,AddrMode::ZER,3 };
+    table[0x96] = { Mnemonic::STX,AddrMode::ZEY,4 };
+
+    table[0x8C] = { Mnemonic::STY,AddrMode::ABS,4 };
+    table[0x84] = { Mnemonic::STY,AddrMode::ZER,3 };
+    table[0x94] = { Mnemonic::STY,AddrMode::ZEX,4 };
+
+    table[0xAA] = { Mnemonic::TAX,AddrMode::IMP,2 };
+
+    table[0xA8] = { Mnemonic::TAY,AddrMode::IMP,2 };
+
+    table[0xBA] = { Mnemonic::TSX,AddrMode::IMP,2 };
+
+    table[0x8A] = { Mnemonic::TXA,AddrMode::IMP,2 };
+
+    table[0x9A] = { Mnemonic::TXS,AddrMode::IMP,2 };
+
+    table[0x98] = { Mnemonic::TYA,AddrMode::IMP,2 };
+
+    if(variant != Variant::CMOS)
+    {
+        // Undocumented OPCODEs that halt the processor
+        for(int i : { 0x02,0x12,0x22,0x32,0x42,0x52,0x62,0x72,0x92,0xB2,0xD2,0xF2 })
+            table[i] = { Mnemonic::JAM,AddrMode::IMP,0 };
+        return table;
+    }
+
+    /* 65C02 */
+    table[0x72] = { Mnemonic::ADC,AddrMode::ZPI,5 };
+    table[0x32] = { Mnemonic::AND,AddrMode::ZPI,5 };
+    table[0xD2] = { Mnemonic::CMP,AddrMode::ZPI,5 };
+    table[0x52] = { Mnemonic::EOR,AddrMode::ZPI,5 };
+    table[0xB2] = { Mnemonic::LDA,AddrMode::ZPI,5 };
+    table[0x12] = { Mnemonic::ORA,AddrMode::ZPI,5 };
+    table[0xF2] = { Mnemonic::SBC,AddrMode::ZPI,5 };
+    table[0x92] = { Mnemonic::STA,AddrMode::ZPI,5 };
+
+    table[0x89] = { Mnemonic::BIT_IMM,AddrMode::IMM,2 };
+    table[0x34] = { Mnemonic::BIT,AddrMode::ZEX,4 };
+    table[0x3C] = { Mnemonic::BIT,AddrMode::ABX,4 };
+
+    table[0x80] = { Mnemonic::BRA,AddrMode::REL,2 };
+
+    table[0x3A] = { Mnemonic::DEC_ACC,AddrMode::ACC,2 };
+    table[0x1A] = { Mnemonic::INC_ACC,AddrMode::ACC,2 };
+
+    table[0x6C] = { Mnemonic::JMP,AddrMode::ABI,6 };
+    table[0x7C] = { Mnemonic::JMP,AddrMode::AIX,6 };
+
+    table[0xDA] = { Mnemonic::PHX,AddrMode::IMP,3 };
+    table[0x5A] = { Mnemonic::PHY,AddrMode::IMP,3 };
+    table[0xFA] = { Mnemonic::PLX,AddrMode::IMP,4 };
+    table[0x7A] = { Mnemonic::PLY,AddrMode::IMP,4 };
+
+    table[0x9C] = { Mnemonic::STZ,AddrMode::ABS,4 };
+    table[0x64] = { Mnemonic::STZ,AddrMode::ZER,3 };
+    table[0x74] = { Mnemonic::STZ,AddrMode::ZEX,4 };
+    table[0x9E] = { Mnemonic::STZ,AddrMode::ABX,5 };
+
+    table[0x1C] = { Mnemonic::TRB,AddrMode::ABS,6 };
+    table[0x14] = { Mnemonic::TRB,AddrMode::ZER,5 };
+
+    table[0x0C] = { Mnemonic::TSB,AddrMode::ABS,6 };
+    table[0x04] = { Mnemonic::TSB,AddrMode::ZER,5 };
+
+    // Shifts and rotates through ABX only spend the extra cycle on a page crossing
+    for(int i : { 0x1E,0x3E,0x5E,0x7E })
+        table[i].cycles = 6;
+
+    // Undefined OPCODEs are NOPs, some of them skip operand bytes
+    for(int i : { 0x02,0x22,0x42,0x62,0x82,0xC2,0xE2 })
+        table[i] = { Mnemonic::NOP,AddrMode::IMM,2 };
+    table[0x44] = { Mnemonic::NOP,AddrMode::ZER,3 };
+    for(int i : { 0x54,0xD4,0xF4 })
+        table[i] = { Mnemonic::NOP,AddrMode::ZEX,4 };
+    table[0x5C] = { Mnemonic::NOP,AddrMode::ABS,8 };
+    for(int i : { 0xDC,0xFC })
+        table[i] = { Mnemonic::NOP,AddrMode::ABS,4 };
+    for(int i = 0;i < 256;i++)
+        if(table[i].operation == Mnemonic::ILLEGAL)
+            table[i] = { Mnemonic::NOP,AddrMode::IMP,1 }; // columns 3, 7, B and F
+
+    return table;
+}
+
+constexpr std::array<std::array<OPCODE,256>,VARIANT_COUNT> OPCODE_TABLES =
+{{
+    makeOpcodeTable(Variant::NMOS),makeOpcodeTable(Variant::RP2A03),makeOpcodeTable(Variant::CMOS)
+}};
+
+constexpr const std::array<OPCODE,256>& opcodeTable(Variant variant) { return OPCODE_TABLES[static_cast<uint8_t>(variant)]; }
+
+constexpr std::array<OPCODE,256> OPCODES = OPCODE_TABLES[0]; // NMOS, for tools that do not know the variant
+
+constexpr uint8_t operandLength(AddrMode addr) // bytes following the OPCODE
+{
+    switch(addr)
+    {
+        case AddrMode::ACC: case AddrMode::IMP: return 0;
+        case AddrMode::ABS: case AddrMode::ABX: case AddrMode::ABY: case AddrMode::ABI: case AddrMode::AIX: return 2;
+        default: return 1;
+    }
+}
+
+constexpr bool isZeroPage(AddrMode addr) { return addr == AddrMode::ZER || addr == AddrMode::ZEX || addr == AddrMode::ZEY; } // operand in $0000-$00FF
+
+constexpr bool changesControlFlow(Mnemonic operation) // PC does not simply move to the next instruction
+{
+    switch(operation)
+    {
+        case Mnemonic::BCC: case Mnemonic::BCS: case Mnemonic::BEQ: case Mnemonic::BMI:
+        case Mnemonic::BNE: case Mnemonic::BPL: case Mnemonic::BVC: case Mnemonic::BVS:
+        case Mnemonic::BRA: case Mnemonic::JMP: case Mnemonic::JSR: case Mnemonic::RTS: case Mnemonic::RTI:
+        case Mnemonic::BRK: case Mnemonic::JAM: case Mnemonic::ILLEGAL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+constexpr bool addsPageCrossCycle(Variant variant,Mnemonic operation,AddrMode addr) // indexed read pays for carrying into the high byte
+{
+    if(addr != AddrMode::ABX && addr != AddrMode::ABY && addr != AddrMode::INY) return false;
+    switch(operation)
+    {
+        case Mnemonic::ADC: case Mnemonic::AND: case Mnemonic::BIT: case Mnemonic::CMP: case Mnemonic::EOR:
+        case Mnemonic::LDA: case Mnemonic::LDX: case Mnemonic::LDY: case Mnemonic::ORA: case Mnemonic::SBC:
+            return true;
+        case Mnemonic::ASL: case Mnemonic::LSR: case Mnemonic::ROL: case Mnemonic::ROR:
+            return variant == Variant::CMOS;
+        default:
+            return false; // stores and read-modify-write always spend that cycle, it is in their count
+    }
+}
+
+constexpr const char* mnemonicName(Mnemonic operation) // assembler spelling, for tools and reports
+{
+    constexpr const char* NAMES[] =
+    {
+        "ADC","AND","ASL","ASL","BCC","BCS","BEQ","BIT","BMI","BNE",
+        "BPL","BRK","BVC","BVS","CLC","CLD","CLI","CLV","CMP","CPX",
+        "CPY","DEC","DEX","DEY","EOR","INC","INX","INY","JMP","JSR",
+        "LDA","LDX","LDY","LSR","LSR","NOP","ORA","PHA","PHP","PLA",
+        "PLP","ROL","ROL","ROR","ROR","RTI","RTS","SBC","SEC","SED",
+        "SEI","STA","STX","STY","TAX","TAY","TSX","TXA","TXS","TYA",
+        "BIT","BRA","DEC","INC","PHX","PHY","PLX","PLY","STZ","TRB",
+        "TSB",
+        "JAM","???"
+    };
+    return NAMES[static_cast<uint8_t>(operation)];
+}
+
+constexpr const char* addrModeName(AddrMode addr)
+{
+    constexpr const char* NAMES[] = { "ACC","IMM","ABS","ZER","ZEX","ZEY","ABX","ABY","IMP","REL","INX","INY","ABI","ZPI","AIX" };
+    return NAMES[static_cast<uint8_t>(addr)];
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "Profiler.h"
+#include <iomanip>
+
+Profiler::Profiler()
+{
+	clear();
+}
+
+void Profiler::clear()
+{
+	pcCycles.assign(0x10000,0);
+	opcodeCycles.assign(256,0);
+	opcodeCount.assign(256,0);
+	interruptCycles = 0;
+
+	nodes.clear();
+	nodes.push_back({ 0x0000,0 });
+	children.clear();
+	current = 0;
+	depth = 0;
+	hiddenDepth = 0;
+}
+
+void Profiler::call(ADDRESS target)
+{
+	if(depth >= MAX_DEPTH)
+	{
+		hiddenDepth++; // e.g. code that leaves subroutines with PLA/PLA instead of RTS
+		return;
+	}
+
+	uint64_t key = ((uint64_t)current << 16) | target;
+	auto found = children.find(key);
+	if(found == children.end())
+	{
+		nodes.push_back({ target,current });
+		found = children.emplace(key,nodes.size() - 1).first;
+	}
+	current = found->second;
+	depth++;
+}
+
+void Profiler::ret()
+{
+	if(hiddenDepth)
+	{
+		hiddenDepth--;
+		return;
+	}
+	if(!depth) return; // RTS used as a computed jump at top level
+	current = nodes[current].parent;
+	depth--;
+}
+
+void Profiler::interrupt(ADDRESS target,uint32_t cycles)
+{
+	call(target);
+	pcCycles[target] += cycles;
+	nodes[current].cycles += cycles; // innermost recorded frame, the handler unless past MAX_DEPTH
+	interruptCycles += cycles;
+}
+
+uint64_t Profiler::getTotalCycles() const
+{
+	uint64_t total = interruptCycles;
+	for(uint64_t cycles : opcodeCycles)
+		total += cycles;
+	return total;
+}
+
+void Profiler::writeStack(std::ostream& out,uint32_t node) const
+{
+	if(!node)
+	{
+		out << "main";
+		return;
+	}
+	writeStack(out,nodes[node].parent);
+	out << ";$" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << nodes[node].address;
+}
+
+void Profiler::writeCollapsed(std::ostream& out) const
+{
+	for(uint32_t node = 0;node < nodes.size();node++)
+	{
+		if(!nodes[node].cycles) continue;
+		writeStack(out,node);
+		out << ' ' << std::dec << nodes[node].cycles << '\n';
+	}
+}
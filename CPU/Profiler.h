@@ -0,0 +1,81 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include "../Utils/handler.h"
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+/*
+
+    GUEST PROFILER
+
+    Cycle histograms of a guest program, filled by CPU while it is attached with CPU::setProfiler().
+    Every instruction adds its cycles to the counter of its PC and of its OPCODE.
+    JSR, BRK and interrupts enter a function, RTS and RTI leave it, and cycles are also
+    summed per call stack (kept as a tree of distinct stacks), which writeCollapsed() prints in the
+    collapsed stack format flamegraph.pl and speedscope read.
+    The 7 cycles of an IRQ/NMI entry belong to no instruction, they are added to the handler's
+    frame and first PC so the totals match the cycles the CPU ran.
+
+    While a profiler is attached CPU steps one instruction at a time on the SWITCH backend,
+    runs without one use the same code as before, so profiling costs nothing when it is off.
+
+*/
+
+class Profiler
+{
+    public:
+        Profiler();
+
+        void clear(); // drop all counts, call stack starts at the root again
+
+        void record(ADDRESS pc,uint8_t opcode,uint32_t cycles) // one executed instruction
+        {
+            pcCycles[pc] += cycles;
+            opcodeCycles[opcode] += cycles;
+            opcodeCount[opcode]++;
+            nodes[current].cycles += cycles;
+        }
+
+        void call(ADDRESS target); // JSR or BRK entered the function at target
+
+        void interrupt(ADDRESS target,uint32_t cycles); // IRQ/NMI entered its handler, the entry cycles count for the handler
+
+        void ret(); // RTS or RTI
+
+        const uint64_t* getPCCycles() const { return pcCycles.data(); }       // 65536 entries
+        const uint64_t* getOpcodeCycles() const { return opcodeCycles.data(); } // 256 entries
+        const uint64_t* getOpcodeCount() const { return opcodeCount.data(); }   // 256 entries
+
+        uint64_t getTotalCycles() const; // instructions and interrupt entries
+
+        uint64_t getInterruptCycles() const { return interruptCycles; } // IRQ/NMI entries, not in any OPCODE counter
+
+        void writeCollapsed(std::ostream& out) const; // "main;$C000;$C1F0 cycles" per call stack
+
+    private:
+        static const uint32_t MAX_DEPTH = 256; // deeper calls are counted but not recorded as frames
+
+        struct NODE // one distinct call stack
+        {
+            ADDRESS address; // entry of the innermost function
+            uint32_t parent;
+            uint64_t cycles = 0; // spent in this function itself
+        };
+
+        std::vector<uint64_t> pcCycles;
+        std::vector<uint64_t> opcodeCycles;
+        std::vector<uint64_t> opcodeCount;
+        uint64_t interruptCycles = 0;
+
+        std::vector<NODE> nodes; // nodes[0] is the root
+        std::unordered_map<uint64_t,uint32_t> children; // parent << 16 | address -> node
+        uint32_t current = 0;
+        uint32_t depth = 0;
+        uint32_t hiddenDepth = 0; // calls past MAX_DEPTH, left before the recorded stack is popped
+
+        void writeStack(std::ostream& out,uint32_t node) const;
+};
+
+
+#endif
@@ -0,0 +1,117 @@
+#include "Tracer.h"
+#include "../Utils/DeltaCodec.h"
+#include <cstring>
+#include <chrono>
+
+static_assert(sizeof(Tracer::RECORD) == 18,"RECORD is written to disk as raw bytes");
+
+constexpr char Tracer::MAGIC[8];
+
+Tracer::Tracer(const char* path,size_t requested)
+{
+	capacity = 1;
+	while(capacity < requested) capacity <<= 1;
+	mask = capacity - 1;
+	ring.reset(new RECORD[capacity]);
+
+	file = fopen(path,"wb");
+	if(!file) return;
+	fwrite(MAGIC,1,sizeof(MAGIC),file);
+	bytesWritten = sizeof(MAGIC);
+	writer = std::thread(&Tracer::write,this);
+}
+
+Tracer::~Tracer()
+{
+	stopping.store(true,std::memory_order_release);
+	if(writer.joinable()) writer.join();
+	if(file) fclose(file);
+}
+
+void Tracer::waitForSpace(uint64_t position)
+{
+	if(!file) // nothing drains the ring, records are dropped
+	{
+		tail.store(position,std::memory_order_relaxed);
+		tailCache = position;
+		return;
+	}
+	while(position - (tailCache = tail.load(std::memory_order_acquire)) >= capacity)
+		std::this_thread::yield();
+}
+
+void Tracer::write()
+{
+	RECORD previous;
+	memset(&previous,0,sizeof(previous));
+	std::vector<RECORD> chunk(CHUNK_RECORDS);
+	std::vector<BYTE> planes(CHUNK_RECORDS * sizeof(RECORD)),packed;
+
+	while(true)
+	{
+		bool stop = stopping.load(std::memory_order_acquire); // read before head, records pushed before stop are seen
+		uint64_t first = tail.load(std::memory_order_relaxed);
+		uint64_t available = head.load(std::memory_order_acquire) - first;
+		if(!available)
+		{
+			if(stop) break;
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			continue;
+		}
+
+		uint32_t count = available < CHUNK_RECORDS ? available : CHUNK_RECORDS;
+		size_t start = first & mask;
+		size_t wrapped = start + count > capacity ? start + count - capacity : 0;
+		memcpy(chunk.data(),&ring[start],(count - wrapped) * sizeof(RECORD));
+		memcpy(chunk.data() + count - wrapped,&ring[0],wrapped * sizeof(RECORD));
+		tail.store(first + count,std::memory_order_release); // slots are free again once copied
+
+		writeChunk(chunk.data(),count,previous,planes,packed);
+	}
+	fflush(file);
+}
+
+void Tracer::writeChunk(const RECORD* records,uint32_t count,RECORD& previous,std::vector<BYTE>& planes,std::vector<BYTE>& packed)
+{
+	// Consecutive records differ in a few bytes: XOR each with the one before it and
+	// store byte b of every record together, so unchanged fields become long zero runs.
+	// One plane at a time, so writes stay sequential
+	const BYTE* raw = reinterpret_cast<const BYTE*>(records);
+	const BYTE* before = reinterpret_cast<const BYTE*>(&previous);
+	for(size_t b = 0;b < sizeof(RECORD);b++)
+	{
+		BYTE* plane = &planes[b * count];
+		plane[0] = raw[b] ^ before[b];
+		for(uint32_t i = 1;i < count;i++)
+			plane[i] = raw[i * sizeof(RECORD) + b] ^ raw[(i - 1) * sizeof(RECORD) + b];
+	}
+	previous = records[count - 1];
+
+	static const std::vector<BYTE> zeros(CHUNK_RECORDS * sizeof(RECORD),0);
+	packed.clear();
+	encodeDelta(zeros.data(),planes.data(),count * sizeof(RECORD),packed);
+
+	uint32_t header[2] = { count,(uint32_t)packed.size() };
+	fwrite(header,sizeof(header),1,file);
+	fwrite(packed.data(),1,packed.size(),file);
+	bytesWritten += sizeof(header) + packed.size();
+}
+
+bool Tracer::unpackChunk(const BYTE* packed,size_t packedSize,uint32_t count,RECORD& previous,std::vector<RECORD>& records)
+{
+	std::vector<BYTE> planes(count * sizeof(RECORD),0);
+	if(!applyDelta(packed,packedSize,planes.data(),planes.size()))
+		return false;
+
+	records.resize(count);
+	const BYTE* before = reinterpret_cast<const BYTE*>(&previous);
+	for(uint32_t i = 0;i < count;i++)
+	{
+		BYTE* record = reinterpret_cast<BYTE*>(&records[i]);
+		for(size_t b = 0;b < sizeof(RECORD);b++)
+			record[b] = planes[b * count + i] ^ before[b];
+		before = record;
+	}
+	if(count) previous = records[count - 1];
+	return true;
+}
@@ -0,0 +1,96 @@
+#ifndef TRACER_H
+#define TRACER_H
+#include "../Utils/handler.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstdio>
+
+/*
+
+    INSTRUCTION TRACER
+
+    CPU (attached with CPU::setTracer()) writes every instruction into the ring as an 18 byte RECORD:
+    PC, OPCODE and operand bytes, A/X/Y/SP/P and the cycle, all taken before it executes.
+    Records go into a single producer / single consumer ring, the emulation thread only
+    copies a record and bumps an index. A writer thread takes them out in chunks,
+    XORs every record with the one before it, groups the bytes by field, packs the result
+    with the delta codec (Utils/DeltaCodec.h) and appends it to the trace file. When the ring is full
+    the emulation thread waits for the writer, no record is ever dropped.
+    Like with a Profiler, CPU steps one instruction at a time on the SWITCH backend while tracing.
+
+    FILE : "6502TRC1", then per chunk uint32 record count, uint32 packed size, packed bytes.
+           Packed bytes unpack to byte 0 of every record, then byte 1 of every record, and so on.
+    Tools/TraceDump.cpp turns a trace file into nestest style text.
+
+*/
+
+class Tracer
+{
+    public:
+#pragma pack(push,1)
+        struct RECORD
+        {
+            uint64_t cycle;
+            ADDRESS pc;
+            uint8_t bytes[3]; // OPCODE and operand bytes, unused ones are 0
+            uint8_t A,X,Y,SP;
+            uint8_t P; // as PHP pushes it, with bit 5 set
+        };
+#pragma pack(pop)
+
+        static constexpr char MAGIC[8] = { '6','5','0','2','T','R','C','1' };
+
+        static const size_t CHUNK_RECORDS = 4096; // records per packed chunk
+
+        explicit Tracer(const char* path,size_t capacity = 1 << 16); // capacity in records (rounded up to a power of 2), small enough to stay in cache
+
+        ~Tracer(); // writes out every record and closes the file
+
+        Tracer(const Tracer&) = delete;
+
+        bool isOpen() const { return file != nullptr; }
+
+        RECORD& next() // slot for the next record, filled in place and published by commit()
+        {
+            uint64_t position = head.load(std::memory_order_relaxed);
+            if(position - tailCache >= capacity) waitForSpace(position);
+            return ring[position & mask];
+        }
+
+        void commit() { head.store(head.load(std::memory_order_relaxed) + 1,std::memory_order_release); }
+
+        uint64_t getRecordCount() const { return head.load(std::memory_order_relaxed); }
+
+        uint64_t getBytesWritten() const { return bytesWritten.load(std::memory_order_relaxed); } // file size so far
+
+        // Unpack one chunk, previous is the last record of the chunk before (zeroed for the first chunk)
+        static bool unpackChunk(const BYTE* packed,size_t packedSize,uint32_t count,RECORD& previous,std::vector<RECORD>& records);
+
+    private:
+        std::unique_ptr<RECORD[]> ring;
+        size_t capacity;
+        uint64_t mask;
+
+        /* PRODUCER (emulation thread) */
+        alignas(64) std::atomic<uint64_t> head{0};
+        uint64_t tailCache = 0; // last tail seen, reloaded only when the ring looks full
+
+        /* CONSUMER (writer thread) */
+        alignas(64) std::atomic<uint64_t> tail{0};
+        std::atomic<bool> stopping{false};
+        std::atomic<uint64_t> bytesWritten{0};
+
+        FILE* file = nullptr;
+        std::thread writer;
+
+        void waitForSpace(uint64_t position);
+
+        void write(); // writer thread
+
+        void writeChunk(const RECORD* records,uint32_t count,RECORD& previous,std::vector<BYTE>& planes,std::vector<BYTE>& packed);
+};
+
+
+#endif
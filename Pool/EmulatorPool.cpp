@@ -0,0 +1,227 @@
+#include "EmulatorPool.h"
+#include <cstring>
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+EmulatorPool::MACHINE::MACHINE(CPU::DISPATCH dispatch) : cpu(ram,ppu,dispatch),powerOn(cpu,cpu.getBus(),ppu),cartridgeOn(cpu,cpu.getBus(),ppu)
+{
+    cpu.setIdleLoopSkip(true); // results are the same, frames waiting for VBLANK finish sooner
+    powerOn.capture();
+}
+
+EmulatorPool::EmulatorPool(size_t workerCount,CPU::DISPATCH dispatch) : dispatch(dispatch)
+{
+    if(!workerCount) workerCount = std::max(1u,std::thread::hardware_concurrency());
+
+    queues.reset(new QUEUE[workerCount]);
+    for(size_t i = 0;i < workerCount;i++)
+        workers.emplace_back(&EmulatorPool::work,this,i);
+}
+
+EmulatorPool::~EmulatorPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(std::thread& worker : workers)
+        worker.join();
+}
+
+std::future<EmulatorPool::RESULT> EmulatorPool::submit(JOB job)
+{
+    TASK task;
+    task.job = std::move(job);
+    task.submitted = CLOCK::now();
+    std::future<RESULT> result = task.promise.get_future();
+
+    QUEUE& queue = queues[nextQueue++ % workers.size()];
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(std::move(task));
+        queued++; // counted under the queue lock, like take() counts down, so it never drops below the tasks queued
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock); // a worker between checking queued and waiting cannot miss this wake up
+    }
+    wake.notify_one();
+    return result;
+}
+
+void EmulatorPool::work(size_t index)
+{
+    pin(index);
+    std::unique_ptr<MACHINE> machine(new MACHINE(dispatch)); // built after pinning, memory is local to this core
+
+    while(true)
+    {
+        TASK task;
+        bool stolen = false;
+        if(!take(index,task,stolen))
+        {
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wake.wait(guard,[this] { return stopping || queued > 0; });
+            if(stopping && queued == 0) return;
+            continue;
+        }
+
+        CLOCK::time_point started = CLOCK::now();
+        RESULT result = runJob(*machine,task.job);
+        result.worker = index;
+        result.stolen = stolen;
+        result.queueSeconds = std::chrono::duration<double>(started - task.submitted).count();
+        task.promise.set_value(result);
+    }
+}
+
+bool EmulatorPool::take(size_t index,TASK& task,bool& stolen)
+{
+    {
+        QUEUE& own = queues[index];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if(!own.tasks.empty())
+        {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+
+    // Steal the newest task of the next busy worker, its owner keeps working from the other end
+    for(size_t i = 1;i < workers.size();i++)
+    {
+        QUEUE& victim = queues[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if(victim.tasks.empty()) continue;
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        queued--;
+        stolen = true;
+        return true;
+    }
+    return false;
+}
+
+void EmulatorPool::pin(size_t index)
+{
+#ifdef __linux__
+    unsigned cores = std::max(1u,std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cores,&set);
+    pthread_setaffinity_np(pthread_self(),sizeof(set),&set); // best effort, runs unpinned if not allowed
+#endif
+}
+
+EmulatorPool::RESULT EmulatorPool::runJob(MACHINE& machine,const JOB& job)
+{
+    RESULT result;
+    CPU& cpu = machine.cpu;
+    Bus& bus = cpu.getBus();
+
+    CLOCK::time_point start = CLOCK::now();
+
+    if(job.cartridge != machine.cartridge && !switchCartridge(machine,job.cartridge)) return result;
+
+    // only pages written by the previous job are copied
+    if(machine.cartridge) machine.cartridgeOn.restore();
+    else machine.powerOn.restore();
+
+    if(!job.cartridge && job.rom)
+    {
+        // Host copy straight into the pages, marked dirty so the next restore() undoes it
+        const std::vector<BYTE>& rom = *job.rom;
+        size_t size = std::min(rom.size(),(size_t)0x10000 - job.loadAddress);
+        for(size_t offset = 0;offset < size;)
+        {
+            ADDRESS address = job.loadAddress + offset;
+            size_t length = std::min(size - offset,(size_t)(0x100 - (address & 0xFF)));
+            BYTE* host = bus.getPage(address).write;
+            if(host)
+            {
+                memcpy(host + (address & 0xFF),rom.data() + offset,length);
+                bus.markDirty(address);
+                cpu.invalidateCode(address >> 8);
+            }
+            offset += length;
+        }
+    }
+    cpu.setProgramCounter(bus.read(0xFFFC) | (bus.read(0xFFFD) << 8)); // reset vector
+
+    CLOCK::time_point loaded = CLOCK::now();
+
+    uint64_t firstCycle = cpu.getCycleIndex();
+    for(uint32_t frame = 0;frame < job.frames;frame++)
+    {
+        if(frame < job.input.size()) bus.write(job.inputAddress,job.input[frame]);
+        result.stopReason = cpu.runFrames(1);
+        if(result.stopReason != CPU::STOP_REASON::BUDGET_EXHAUSTED) break;
+        result.framesRun++;
+    }
+    result.cycles = cpu.getCycleIndex() - firstCycle;
+    result.hash = hashMachine(cpu,bus);
+
+    CLOCK::time_point finished = CLOCK::now();
+    result.resetSeconds = std::chrono::duration<double>(loaded - start).count();
+    result.runSeconds = std::chrono::duration<double>(finished - loaded).count();
+    return result;
+}
+
+bool EmulatorPool::switchCartridge(MACHINE& machine,const std::shared_ptr<const Cartridge>& cartridge)
+{
+    Bus& bus = machine.cpu.getBus();
+    if(!cartridge) // back to the flat machine powerOn was captured on, its next restore() is a full copy
+    {
+        for(int page = 0x80;page <= 0xFF;page++)
+            bus.restorePage(page,machine.flatPages[page - 0x80],machine.flatHandlers[page - 0x80]);
+        machine.cartridge.reset();
+        return true;
+    }
+
+    if(!machine.cartridge)
+        for(int page = 0x80;page <= 0xFF;page++)
+        {
+            machine.flatPages[page - 0x80] = bus.getPage(page << 8);
+            machine.flatHandlers[page - 0x80] = bus.getMMIO(page << 8);
+        }
+    if(!cartridge->map(bus)) return false; // Bus is left as it was
+
+    machine.powerOn.restore(); // RAM below $8000 as at power-on, full copy since the mapping changed
+    machine.cartridgeOn.capture();
+    machine.cartridge = cartridge; // kept mapped, and alive, until a job needs another layout
+    return true;
+}
+
+uint64_t EmulatorPool::hashMachine(CPU& cpu,Bus& bus)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL; // FNV-1a
+    auto mix = [&hash](BYTE value)
+    {
+        hash ^= value;
+        hash *= 0x100000001B3ULL;
+    };
+
+    CPU::STATE state;
+    cpu.saveState(state);
+    mix(state.A);
+    mix(state.X);
+    mix(state.Y);
+    mix(state.SP);
+    mix(state.P);
+    mix(state.programCounter & 0xFF);
+    mix(state.programCounter >> 8);
+
+    for(int page = 0;page < 256;page++)
+    {
+        const BYTE* host = bus.getPage(page << 8).read;
+        if(!host) continue; // MMIO is not read, reading may have side effects
+        for(int i = 0;i < 256;i++)
+            mix(host[i]);
+    }
+    return hash;
+}
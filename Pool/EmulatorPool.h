@@ -0,0 +1,136 @@
+#ifndef EMULATORPOOL_H
+#define EMULATORPOOL_H
+#include "../Utils/handler.h"
+#include "../CPU/CPU.h"
+#include "../State/SaveState.h"
+#include "../Bus/Cartridge.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <chrono>
+
+/*
+
+    EMULATOR POOL
+
+    Runs independent JOBs ("ROM X, input stream Y, N frames") on a fixed set of machines.
+    Every worker thread owns one MACHINE (RAM, PPU, CPU), is pinned to its own core (Linux)
+    and builds the MACHINE on that thread, so its memory is allocated on that core's node.
+    Each worker has its own deque of tasks. submit() deals jobs round robin, a worker takes
+    the oldest task of its own deque and, once that is empty, steals the newest one of another.
+    Workers only meet on a queue lock when stealing, so throughput scales with cores.
+
+    A MACHINE is never reconstructed between jobs. Right after construction it captures a
+    power-on SaveState and every job starts with restoring it, which only copies back the
+    pages the previous job wrote. MACHINEs skip idle loops (CPU::setIdleLoopSkip), which does
+    not change results.
+    A JOB with a Cartridge does not copy its ROM at all, its PRG pages are mapped and every MACHINE
+    reads the same page cache copy. A MACHINE keeps the Cartridge mapped, with a second power-on
+    SaveState captured that way, so jobs of the same Cartridge restore incrementally as well.
+    Only a change of layout (other Cartridge or none) costs a remap and a full copy.
+    A Cartridge that map() refuses (not NROM) runs no frames.
+
+*/
+
+class EmulatorPool
+{
+    public:
+        struct JOB
+        {
+            std::shared_ptr<const std::vector<BYTE>> rom; // shared by every job running the same ROM
+            ADDRESS loadAddress = 0x8000; // rom is copied here, must be writable RAM of the flat machine
+            std::shared_ptr<const Cartridge> cartridge; // NROM image mapped read-only at $8000-$FFFF instead of copying rom
+            std::vector<BYTE> input; // one byte per frame, written to inputAddress before the frame runs
+            ADDRESS inputAddress = 0x00FF;
+            uint32_t frames = 0;
+        };
+
+        struct RESULT
+        {
+            uint64_t hash = 0; // FNV-1a of registers and the 64KB address space after the last frame
+            CPU::STOP_REASON stopReason = CPU::STOP_REASON::BUDGET_EXHAUSTED;
+            uint32_t framesRun = 0;
+            uint64_t cycles = 0;
+            uint32_t worker = 0;   // worker (and MACHINE) that ran the job
+            bool stolen = false;   // taken from the deque of another worker
+
+            /* TIMING (seconds) */
+            double queueSeconds = 0; // submit() until a worker took it
+            double resetSeconds = 0; // power-on restore and ROM load
+            double runSeconds = 0;   // emulated frames
+        };
+
+        // workers = 0 uses every hardware thread
+        explicit EmulatorPool(size_t workers = 0,CPU::DISPATCH dispatch = CPU::DISPATCH::SWITCH);
+
+        ~EmulatorPool(); // finishes every submitted job first
+
+        EmulatorPool(const EmulatorPool&) = delete;
+
+        size_t getWorkerCount() const { return workers.size(); }
+
+        std::future<RESULT> submit(JOB job);
+
+    private:
+        using CLOCK = std::chrono::steady_clock;
+
+        struct MACHINE
+        {
+            RAM ram;
+            PPU ppu;
+            CPU cpu;
+            SaveState powerOn;
+
+            std::shared_ptr<const Cartridge> cartridge; // mapped at $8000-$FFFF, nullptr while the machine is flat
+            SaveState cartridgeOn; // power-on with cartridge mapped
+            Bus::PAGE flatPages[0x80]; // $8000-$FFFF of the flat machine, put back when a job has no cartridge
+            Bus::MMIO flatHandlers[0x80];
+
+            explicit MACHINE(CPU::DISPATCH dispatch);
+        };
+
+        struct TASK
+        {
+            JOB job;
+            std::promise<RESULT> promise;
+            CLOCK::time_point submitted;
+        };
+
+        struct alignas(64) QUEUE // own cache line, workers lock their own queue on every pop
+        {
+            std::mutex lock;
+            std::deque<TASK> tasks;
+        };
+
+        CPU::DISPATCH dispatch;
+
+        std::vector<std::thread> workers;
+        std::unique_ptr<QUEUE[]> queues;
+
+        std::atomic<size_t> nextQueue{0};
+        std::atomic<size_t> queued{0}; // tasks in all queues, changed under the lock of the queue the task enters or leaves
+
+        std::mutex sleepLock;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        void work(size_t index);
+
+        bool take(size_t index,TASK& task,bool& stolen); // own queue first, then steal
+
+        static void pin(size_t index);
+
+        static RESULT runJob(MACHINE& machine,const JOB& job);
+
+        static bool switchCartridge(MACHINE& machine,const std::shared_ptr<const Cartridge>& cartridge); // false if it can not be mapped
+
+        static uint64_t hashMachine(CPU& cpu,Bus& bus);
+};
+
+
+#endif
@@ -0,0 +1,149 @@
+#include "Rewind.h"
+#include "../Utils/DeltaCodec.h"
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+
+static_assert(std::is_trivially_copyable<CPU::STATE>::value,"CPU::STATE is stored as raw bytes");
+static_assert(std::is_trivially_copyable<PPU>::value,"PPU is stored as raw bytes");
+
+Rewind::Rewind(CPU& cpu,Bus& bus,PPU& ppu,size_t capacity,uint32_t interval) 
+    : cpu(cpu),bus(bus),ppu(ppu),interval(interval ? interval : 1),ring(capacity)
+{
+    memset(static_cast<void*>(&registers),0,sizeof(registers)); // padding bytes stay zero and delta well
+}
+
+void Rewind::frame()
+{
+    movedSinceCurrent = true;
+    if(++frameCount >= interval)
+    {
+        frameCount = 0;
+        record();
+    }
+}
+
+void Rewind::record()
+{
+    serialize(next);
+
+    if(hasCurrent && next.size() == current.size())
+    {
+        delta.clear();
+        encodeDelta(next.data(),current.data(),next.size(),delta); // next -> current, used when stepping back
+        push(delta);
+    }
+    else
+        clearHistory(); // mapping changed, older states can not be reached by XOR
+
+    current.swap(next);
+    hasCurrent = true;
+    movedSinceCurrent = false;
+}
+
+bool Rewind::stepBack()
+{
+    if(!hasCurrent) return false;
+
+    if(!movedSinceCurrent)
+    {
+        if(entries.empty()) return false;
+
+        ENTRY entry = entries.back();
+        entries.pop_back();
+        used -= entry.size;
+        head = entry.offset;
+
+        delta.resize(entry.size);
+        size_t first = std::min(entry.size,ring.size() - entry.offset);
+        memcpy(delta.data(),&ring[entry.offset],first);
+        memcpy(delta.data() + first,ring.data(),entry.size - first);
+
+        applyDelta(delta.data(),delta.size(),current.data(),current.size());
+    }
+
+    deserialize(current);
+    movedSinceCurrent = false;
+    frameCount = 0;
+    return true;
+}
+
+size_t Rewind::getRecordCount() const
+{
+    return hasCurrent ? entries.size() + 1 : 0;
+}
+
+void Rewind::serialize(std::vector<BYTE>& state)
+{
+    cpu.saveState(registers); // syncs PPU
+
+    state.reserve(sizeof(registers) + sizeof(PPU) + 32 + 256 * 256); // mapped points into state, inserts must not move it
+    state.resize(sizeof(registers) + sizeof(PPU) + 32);
+    BYTE* out = state.data();
+    memcpy(out,&registers,sizeof(registers));
+    memcpy(out + sizeof(registers),static_cast<const void*>(&ppu),sizeof(PPU));
+
+    BYTE* mapped = out + sizeof(registers) + sizeof(PPU); // bit per saved page, keeps layouts with different mappings apart
+    memset(mapped,0,32);
+    for(int page = 0;page < 256;page++)
+    {
+        const BYTE* host = bus.getBackingPage(page << 8);
+        if(!host) continue;
+        mapped[page >> 3] |= 1 << (page & 7);
+        state.insert(state.end(),host,host + 256);
+    }
+}
+
+void Rewind::deserialize(const std::vector<BYTE>& state)
+{
+    const BYTE* in = state.data();
+    memcpy(static_cast<void*>(&registers),in,sizeof(registers));
+    memcpy(static_cast<void*>(&ppu),in + sizeof(registers),sizeof(PPU));
+
+    const BYTE* mapped = in + sizeof(registers) + sizeof(PPU);
+    const BYTE* pageData = mapped + 32;
+    for(int page = 0;page < 256;page++)
+    {
+        if(!(mapped[page >> 3] & (1 << (page & 7)))) continue;
+        BYTE* host = bus.getBackingPage(page << 8);
+        if(host)
+        {
+            memcpy(host,pageData,256);
+            bus.markDirty(page << 8); // keeps incremental SaveState in sync
+            cpu.invalidateCode(page);
+        }
+        pageData += 256;
+    }
+
+    cpu.loadState(registers);
+}
+
+void Rewind::push(const std::vector<BYTE>& data)
+{
+    if(data.size() > ring.size())
+    {
+        clearHistory(); // can not keep a chain with a gap in it
+        return;
+    }
+
+    while(used + data.size() > ring.size())
+    {
+        used -= entries.front().size;
+        entries.pop_front();
+    }
+
+    size_t first = std::min(data.size(),ring.size() - head);
+    memcpy(&ring[head],data.data(),first);
+    memcpy(ring.data(),data.data() + first,data.size() - first);
+
+    entries.push_back({ head,data.size() });
+    head = (head + data.size()) % ring.size();
+    used += data.size();
+}
+
+void Rewind::clearHistory()
+{
+    entries.clear();
+    head = 0;
+    used = 0;
+}
@@ -0,0 +1,72 @@
+#ifndef REWIND_H
+#define REWIND_H
+#include "../Utils/handler.h"
+#include "../CPU/CPU.h"
+#include <vector>
+#include <deque>
+
+/*
+
+    REWIND BUFFER
+
+    Records the machine (CPU STATE, PPU, writable Bus pages) every interval frames.
+    Only the newest record is kept as a full state, every older one is stored as the
+    XOR/RLE delta (Utils/DeltaCodec.h) that turns the next newer state back into it.
+    Deltas live in a ring of fixed capacity, the oldest ones are dropped when it is full.
+    Stepping back costs one delta decode, the host then re-emulates at most interval frames.
+
+*/
+
+class Rewind
+{
+    public:
+        Rewind(CPU& cpu,Bus& bus,PPU& ppu,size_t capacity,uint32_t interval = 1);
+
+        void frame(); // call once per emulated frame, records every interval frames
+
+        void record(); // record machine now
+
+        bool stepBack(); // load newest record not newer than the machine, false if history is empty
+
+        size_t getRecordCount() const; // records that can still be reached
+
+        size_t getUsedBytes() const { return used; }
+
+    private:
+        struct ENTRY
+        {
+            size_t offset; // in ring
+            size_t size;
+        };
+
+        CPU& cpu;
+        Bus& bus;
+        PPU& ppu;
+
+        uint32_t interval;
+        uint32_t frameCount = 0;
+
+        CPU::STATE registers;
+
+        std::vector<BYTE> current; // newest record as a full state
+        std::vector<BYTE> next;
+        std::vector<BYTE> delta;
+        bool hasCurrent = false;
+        bool movedSinceCurrent = false; // machine ran past current
+
+        std::vector<BYTE> ring;
+        size_t head = 0; // where the next delta is written
+        size_t used = 0;
+        std::deque<ENTRY> entries; // oldest first
+
+        void serialize(std::vector<BYTE>& state);
+
+        void deserialize(const std::vector<BYTE>& state);
+
+        void push(const std::vector<BYTE>& data);
+
+        void clearHistory();
+};
+
+
+#endif
@@ -0,0 +1,58 @@
+#include "SaveState.h"
+#include <cstring>
+
+SaveState::SaveState(CPU& cpu,Bus& bus,PPU& ppu) : cpu(cpu),bus(bus),ppu(ppu),ppuState(ppu) { }
+
+void SaveState::capture()
+{
+    cpu.saveState(registers); // syncs PPU before it is copied
+    ppuState = ppu;
+
+    if(isCurrent())
+        copyPages(false,true);
+    else
+    {
+        for(int page = 0;page < 256;page++)
+            writable[page] = bus.getBackingPage(page << 8) != nullptr;
+        copyPages(false,false);
+    }
+
+    epoch = bus.clearDirty();
+    valid = true;
+}
+
+void SaveState::restore()
+{
+    if(!valid) return;
+
+    copyPages(true,isCurrent());
+
+    cpu.loadState(registers);
+    ppu = ppuState;
+
+    epoch = bus.clearDirty();
+}
+
+void SaveState::copyPages(bool toMachine,bool onlyDirty)
+{
+    const uint64_t* dirty = bus.getDirtyPages();
+    for(int word = 0;word < 4;word++)
+    {
+        uint64_t bits = onlyDirty ? dirty[word] : ~0ULL;
+        while(bits)
+        {
+            int page = word * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+
+            BYTE* host = bus.getBackingPage(page << 8);
+            if(!writable[page] || !host) continue; // ROM and MMIO pages without RAM are not part of the snapshot
+
+            if(toMachine)
+            {
+                memcpy(host,pages[page],256);
+                cpu.invalidateCode(page);
+            }
+            else memcpy(pages[page],host,256);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+#include "../Utils/handler.h"
+#include "../CPU/CPU.h"
+
+/*
+
+    SAVE STATE
+
+    Snapshot of a whole machine: CPU registers and flags, currentCycle, scheduled events,
+    every writable memory page of the Bus and the PPU.
+    The Bus tracks which pages were written since the last checkpoint, so once a
+    SaveState holds a full copy, capture() and restore() only copy dirty pages.
+    Only the last SaveState captured or restored on a Bus is incremental,
+    switching to another one costs a full copy once.
+
+*/
+
+class SaveState
+{
+    public:
+        SaveState(CPU& cpu,Bus& bus,PPU& ppu); // binds to one machine
+
+        void capture(); // machine -> snapshot
+
+        void restore(); // snapshot -> machine
+
+        bool isValid() const { return valid; } // false until first capture()
+
+    private:
+        CPU& cpu;
+        Bus& bus;
+        PPU& ppu;
+
+        CPU::STATE registers;
+        PPU ppuState;
+
+        BYTE pages[256][256];
+        bool writable[256]; // page had host memory to save at capture
+
+        uint32_t epoch = 0; // Bus dirty epoch this snapshot is in sync with
+        bool valid = false;
+
+        bool isCurrent() const { return valid && bus.getDirtyEpoch() == epoch; }
+
+        void copyPages(bool toMachine,bool onlyDirty);
+};
+
+
+#endif
@@ -0,0 +1,257 @@
+#include "../CPU/CPU.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+
+    CYCLE TEST
+
+    Runs the per instruction tests of SingleStepTests (github.com/SingleStepTests/65x02, 6502/v1/xx.json,
+    formerly TomHarte/ProcessorTests) through CPU::tick(). Each test gives the registers and RAM before
+    and after one instruction and every bus cycle it takes, the cycle count of CPU must equal
+    the number of bus cycles. Registers and RAM are compared as well unless --cycles-only is given.
+    OPCODEs the CPU treats as ILLEGAL or JAM are skipped.
+    --2a03 runs the nes6502 tests on the RP2A03 core, --65c02 the synertek65c02 tests on the CMOS core.
+
+    usage: CycleTest [--cycles-only] [--verbose] [--2a03 | --65c02] <test file>...
+
+    Exit status is 0 only if every test passed.
+
+*/
+
+using namespace std;
+
+namespace
+{
+    /*------------JSON------------*/
+    // Just enough JSON for the test files: objects, arrays, numbers and strings without escapes
+    struct VALUE
+    {
+        enum KIND { NUMBER,STRING,ARRAY,OBJECT } kind = NUMBER;
+        double number = 0;
+        string text;
+        vector<VALUE> items;
+        vector<string> keys; // OBJECT: name of items[i]
+
+        const VALUE* find(const char* key) const
+        {
+            for(size_t i = 0;i < keys.size();i++)
+                if(keys[i] == key) return &items[i];
+            return nullptr;
+        }
+    };
+
+    class Parser
+    {
+        public:
+            explicit Parser(const string& text) : text(text) { }
+
+            bool parse(VALUE& out) { return value(out) && (skip(),position == text.size()); }
+
+        private:
+            const string& text;
+            size_t position = 0;
+
+            void skip() { while(position < text.size() && strchr(" \t\r\n",text[position])) position++; }
+
+            bool expect(char c) { skip(); if(position < text.size() && text[position] == c) { position++; return true; } return false; }
+
+            bool str(string& out)
+            {
+                if(!expect('"')) return false;
+                size_t end = text.find('"',position);
+                if(end == string::npos) return false;
+                out = text.substr(position,end - position);
+                position = end + 1;
+                return true;
+            }
+
+            bool value(VALUE& out)
+            {
+                skip();
+                if(position >= text.size()) return false;
+                char c = text[position];
+                if(c == '"') { out.kind = VALUE::STRING; return str(out.text); }
+                if(c == '[' || c == '{')
+                {
+                    bool object = c == '{';
+                    out.kind = object ? VALUE::OBJECT : VALUE::ARRAY;
+                    position++;
+                    if(expect(object ? '}' : ']')) return true;
+                    do
+                    {
+                        if(object)
+                        {
+                            out.keys.emplace_back();
+                            if(!str(out.keys.back()) || !expect(':')) return false;
+                        }
+                        out.items.emplace_back();
+                        if(!value(out.items.back())) return false;
+                    } while(expect(','));
+                    return expect(object ? '}' : ']');
+                }
+                char* end;
+                out.number = strtod(text.c_str() + position,&end);
+                if(end == text.c_str() + position) return false;
+                position = end - text.c_str();
+                return true;
+            }
+    };
+
+    bool readFile(const char* path,string& out)
+    {
+        FILE* file = fopen(path,"rb");
+        if(!file) return false;
+        char buffer[1 << 16];
+        size_t count;
+        while((count = fread(buffer,1,sizeof(buffer),file)) > 0)
+            out.append(buffer,count);
+        fclose(file);
+        return true;
+    }
+
+    int field(const VALUE& state,const char* key) { const VALUE* v = state.find(key); return v ? (int)v->number : 0; }
+
+    /*------------TEST------------*/
+    struct MACHINE
+    {
+        unique_ptr<RAM> ram{new RAM()};
+        PPU ppu;
+        CPU cpu;
+
+        explicit MACHINE(Variant variant) : cpu(*ram,ppu,CPU::DISPATCH::SWITCH,variant)
+        {
+            cpu.getScheduler().cancel(Scheduler::PPU_VBLANK); // nothing but the instruction may happen
+        }
+    };
+
+    void load(MACHINE& machine,const VALUE& state)
+    {
+        CPU::STATE registers;
+        machine.cpu.saveState(registers);
+        registers.programCounter = field(state,"pc");
+        registers.SP = field(state,"s");
+        registers.A = field(state,"a");
+        registers.X = field(state,"x");
+        registers.Y = field(state,"y");
+        registers.P = field(state,"p");
+        registers.halted = false;
+        machine.cpu.loadState(registers);
+
+        if(const VALUE* ram = state.find("ram"))
+            for(const VALUE& entry : ram->items)
+                machine.ram->writeToMemory(entry.items[0].number,entry.items[1].number);
+    }
+
+    // Differences between CPU and the expected final state, empty if there are none
+    string compare(MACHINE& machine,const VALUE& state)
+    {
+        CPU::STATE registers;
+        machine.cpu.saveState(registers);
+
+        string out;
+        auto check = [&](const char* name,int have,int want)
+        {
+            if(have == want) return;
+            char line[64];
+            snprintf(line,sizeof(line)," %s=%02X (want %02X)",name,have,want);
+            out += line;
+        };
+        check("PC",registers.programCounter,field(state,"pc"));
+        check("S",registers.SP,field(state,"s"));
+        check("A",registers.A,field(state,"a"));
+        check("X",registers.X,field(state,"x"));
+        check("Y",registers.Y,field(state,"y"));
+        check("P",registers.P | 0x30,field(state,"p") | 0x30); // B and bit 5 are not flags
+
+        if(const VALUE* ram = state.find("ram"))
+            for(const VALUE& entry : ram->items)
+            {
+                ADDRESS address = entry.items[0].number;
+                char name[8];
+                snprintf(name,sizeof(name),"$%04X",address);
+                check(name,machine.ram->readFromMemory(address),(int)entry.items[1].number);
+            }
+        return out;
+    }
+}
+
+int main(int argc,char** argv)
+{
+    bool cyclesOnly = false,verbose = false;
+    Variant variant = Variant::NMOS;
+    vector<const char*> files;
+    for(int i = 1;i < argc;i++)
+    {
+        if(!strcmp(argv[i],"--cycles-only")) cyclesOnly = true;
+        else if(!strcmp(argv[i],"--verbose")) verbose = true;
+        else if(!strcmp(argv[i],"--2a03")) variant = Variant::RP2A03;
+        else if(!strcmp(argv[i],"--65c02")) variant = Variant::CMOS;
+        else files.push_back(argv[i]);
+    }
+    if(files.empty())
+    {
+        fprintf(stderr,"usage: %s [--cycles-only] [--verbose] [--2a03 | --65c02] <test file>...\n",argv[0]);
+        return 2;
+    }
+
+    unsigned long long run = 0,cycleFailures = 0,stateFailures = 0,skipped = 0;
+    for(const char* path : files)
+    {
+        string text;
+        VALUE tests;
+        if(!readFile(path,text) || !Parser(text).parse(tests) || tests.kind != VALUE::ARRAY)
+        {
+            fprintf(stderr,"%s: cannot read tests\n",path);
+            return 1;
+        }
+
+        unsigned long long fileFailures = 0;
+        for(const VALUE& test : tests.items)
+        {
+            const VALUE* initial = test.find("initial");
+            const VALUE* expected = test.find("final");
+            const VALUE* cycles = test.find("cycles");
+            const VALUE* name = test.find("name");
+            if(!initial || !expected || !cycles) continue;
+
+            MACHINE machine(variant);
+            load(machine,*initial);
+            BYTE opcode = machine.ram->readFromMemory(field(*initial,"pc"));
+            const OPCODE& info = opcodeTable(variant)[opcode];
+            Mnemonic operation = info.operation;
+            if(operation == Mnemonic::ILLEGAL || operation == Mnemonic::JAM)
+            {
+                skipped++;
+                continue;
+            }
+
+            uint64_t firstCycle = machine.cpu.getCycleIndex();
+            machine.cpu.tick();
+            uint64_t spent = machine.cpu.getCycleIndex() - firstCycle;
+            run++;
+
+            bool cyclesWrong = spent != cycles->items.size();
+            string difference = cyclesOnly ? string() : compare(machine,*expected);
+            cycleFailures += cyclesWrong;
+            stateFailures += !difference.empty();
+            if(!cyclesWrong && difference.empty()) continue;
+
+            if(fileFailures++ < 5 || verbose)
+            {
+                printf("%s: %s (%s %s):",path,name ? name->text.c_str() : "?",mnemonicName(operation),addrModeName(info.addr));
+                if(cyclesWrong) printf(" cycles=%llu (want %zu)",(unsigned long long)spent,cycles->items.size());
+                printf("%s\n",difference.c_str());
+            }
+        }
+        if(fileFailures > 5 && !verbose)
+            printf("%s: %llu more failures\n",path,fileFailures - 5);
+    }
+
+    printf("%llu tests, %llu wrong cycle counts, %llu wrong results, %llu skipped\n",run,cycleFailures,stateFailures,skipped);
+    return cycleFailures || stateFailures ? 1 : 0;
+}
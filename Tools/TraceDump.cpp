@@ -0,0 +1,131 @@
+#include "../CPU/Tracer.h"
+#include "../CPU/Opcodes.h"
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+/*
+
+    TRACE DUMP
+
+    Prints a trace file written by Tracer (CPU/Tracer.h) as nestest style text:
+
+    C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD CYC:7
+
+    usage: TraceDump [--65c02] <trace file> [first record] [record count]
+
+    --65c02 decodes the trace of a CMOS CPU, NMOS and RP2A03 share the default OPCODE table.
+
+*/
+
+namespace
+{
+    const std::array<OPCODE,256>* opcodes = &OPCODES;
+
+    // "LDA $10,X" and the like, REL shows the branch target
+    void disassemble(const Tracer::RECORD& record,char* out,size_t size)
+    {
+        const OPCODE& info = (*opcodes)[record.bytes[0]];
+        const char* name = mnemonicName(info.operation);
+        uint8_t low = record.bytes[1];
+        ADDRESS absolute = low | (record.bytes[2] << 8);
+
+        switch(info.addr)
+        {
+            case AddrMode::ACC: snprintf(out,size,"%s A",name); break;
+            case AddrMode::IMM: snprintf(out,size,"%s #$%02X",name,low); break;
+            case AddrMode::ZER: snprintf(out,size,"%s $%02X",name,low); break;
+            case AddrMode::ZEX: snprintf(out,size,"%s $%02X,X",name,low); break;
+            case AddrMode::ZEY: snprintf(out,size,"%s $%02X,Y",name,low); break;
+            case AddrMode::ABS: snprintf(out,size,"%s $%04X",name,absolute); break;
+            case AddrMode::ABX: snprintf(out,size,"%s $%04X,X",name,absolute); break;
+            case AddrMode::ABY: snprintf(out,size,"%s $%04X,Y",name,absolute); break;
+            case AddrMode::ABI: snprintf(out,size,"%s ($%04X)",name,absolute); break;
+            case AddrMode::INX: snprintf(out,size,"%s ($%02X,X)",name,low); break;
+            case AddrMode::INY: snprintf(out,size,"%s ($%02X),Y",name,low); break;
+            case AddrMode::ZPI: snprintf(out,size,"%s ($%02X)",name,low); break;
+            case AddrMode::AIX: snprintf(out,size,"%s ($%04X,X)",name,absolute); break;
+            case AddrMode::REL: snprintf(out,size,"%s $%04X",name,(ADDRESS)(record.pc + 2 + (int8_t)low)); break;
+            case AddrMode::IMP: snprintf(out,size,"%s",name); break;
+        }
+    }
+
+    void print(const Tracer::RECORD& record)
+    {
+        uint8_t length = 1 + operandLength((*opcodes)[record.bytes[0]].addr);
+
+        char bytes[9];
+        size_t used = 0;
+        for(uint8_t i = 0;i < length && i < 3;i++)
+            used += snprintf(bytes + used,sizeof(bytes) - used,i ? " %02X" : "%02X",record.bytes[i]);
+        bytes[used] = 0;
+
+        char text[32];
+        disassemble(record,text,sizeof(text));
+
+        printf("%04X  %-8s  %-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu\n",
+               record.pc,bytes,text,record.A,record.X,record.Y,record.P,record.SP,(unsigned long long)record.cycle);
+    }
+}
+
+int main(int argc,char** argv)
+{
+    if(argc > 1 && !strcmp(argv[1],"--65c02"))
+    {
+        opcodes = &opcodeTable(Variant::CMOS);
+        argv++;
+        argc--;
+    }
+    if(argc < 2)
+    {
+        fprintf(stderr,"usage: %s [--65c02] <trace file> [first record] [record count]\n",argv[0]);
+        return 2;
+    }
+    unsigned long long first = argc > 2 ? strtoull(argv[2],nullptr,0) : 0;
+    unsigned long long count = argc > 3 ? strtoull(argv[3],nullptr,0) : ~0ULL;
+
+    FILE* file = fopen(argv[1],"rb");
+    if(!file)
+    {
+        fprintf(stderr,"cannot open %s\n",argv[1]);
+        return 1;
+    }
+
+    char magic[sizeof(Tracer::MAGIC)];
+    if(fread(magic,1,sizeof(magic),file) != sizeof(magic) || memcmp(magic,Tracer::MAGIC,sizeof(magic)))
+    {
+        fprintf(stderr,"%s is not a trace file\n",argv[1]);
+        fclose(file);
+        return 1;
+    }
+
+    Tracer::RECORD previous;
+    memset(&previous,0,sizeof(previous));
+    std::vector<BYTE> packed;
+    std::vector<Tracer::RECORD> records;
+    unsigned long long index = 0;
+    uint32_t header[2];
+    while(count && fread(header,sizeof(header),1,file) == 1)
+    {
+        packed.resize(header[1]);
+        if(fread(packed.data(),1,packed.size(),file) != packed.size() ||
+           !Tracer::unpackChunk(packed.data(),packed.size(),header[0],previous,records))
+        {
+            fprintf(stderr,"%s: damaged chunk after record %llu\n",argv[1],index);
+            fclose(file);
+            return 1;
+        }
+
+        for(const Tracer::RECORD& record : records)
+        {
+            if(index++ < first) continue;
+            if(!count) break;
+            print(record);
+            count--;
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "DeltaCodec.h"
+#include <cstring>
+
+static void putVarint(std::vector<BYTE>& out,size_t value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+}
+
+static bool getVarint(const BYTE*& data,const BYTE* end,size_t& value)
+{
+    value = 0;
+    for(int shift = 0;data < end && shift < 64;shift += 7)
+    {
+        BYTE byte = *data++;
+        value |= (size_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+void encodeDelta(const BYTE* previous,const BYTE* current,size_t size,std::vector<BYTE>& out)
+{
+    size_t i = 0;
+    while(i < size)
+    {
+        // Unchanged bytes are skipped a word at a time
+        size_t zeroStart = i;
+        uint64_t a,b;
+        while(i + 8 <= size && (memcpy(&a,previous + i,8),memcpy(&b,current + i,8),a == b)) i += 8;
+        while(i < size && previous[i] == current[i]) i++;
+
+        // Literal run ends at the first pair of unchanged bytes, single equal bytes stay inside it
+        size_t literalStart = i;
+        while(i < size && (previous[i] != current[i] || (i + 1 < size && previous[i + 1] != current[i + 1]))) i++;
+
+        putVarint(out,literalStart - zeroStart);
+        putVarint(out,i - literalStart);
+        size_t at = out.size();
+        out.resize(at + i - literalStart);
+        BYTE* literal = out.data() + at;
+        for(size_t j = literalStart;j < i;j++)
+            *literal++ = previous[j] ^ current[j];
+    }
+}
+
+bool applyDelta(const BYTE* delta,size_t deltaSize,BYTE* state,size_t size)
+{
+    const BYTE* end = delta + deltaSize;
+    size_t i = 0;
+    while(delta < end)
+    {
+        size_t zeros,literals;
+        if(!getVarint(delta,end,zeros) || !getVarint(delta,end,literals)) return false;
+        if(zeros > size - i || literals > size - i - zeros || literals > (size_t)(end - delta)) return false;
+
+        i += zeros;
+        for(size_t j = 0;j < literals;j++)
+            state[i++] ^= *delta++;
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+#ifndef DELTACODEC_H
+#define DELTACODEC_H
+#include "handler.h"
+#include <vector>
+#include <cstddef>
+
+/*
+
+    XOR/RLE DELTA CODEC
+
+    Encodes the XOR of two equally sized buffers as a list of
+    (zero run, literal run) pairs, both lengths as LEB128 varints,
+    followed by the literal bytes. Buffers that barely changed turn
+    into a few bytes, decoding XORs the literals back in place.
+
+*/
+
+// Append XOR delta of previous and current to out
+void encodeDelta(const BYTE* previous,const BYTE* current,size_t size,std::vector<BYTE>& out);
+
+// XOR delta (from encodeDelta) into state, returns false if delta does not fit state
+bool applyDelta(const BYTE* delta,size_t deltaSize,BYTE* state,size_t size);
+
+
+#endif
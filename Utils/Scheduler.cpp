@@ -0,0 +1,113 @@
+#include "Scheduler.h"
+
+Scheduler::Scheduler()
+{
+    for(int i = 0;i < EVENT_COUNT;i++)
+    {
+        position[i] = EVENT_COUNT;
+        handlers[i] = nullptr;
+        contexts[i] = nullptr;
+    }
+}
+
+void Scheduler::setHandler(EVENT event,HANDLER handler,void* context)
+{
+    handlers[event] = handler;
+    contexts[event] = context;
+}
+
+void Scheduler::schedule(EVENT event,uint64_t cycle)
+{
+    uint8_t index = position[event];
+    if(index == EVENT_COUNT)
+    {
+        index = count++;
+        place(index,{ cycle,event });
+        siftUp(index);
+        return;
+    }
+
+    bool earlier = cycle < heap[index].cycle;
+    heap[index].cycle = cycle;
+    if(earlier) siftUp(index);
+    else siftDown(index);
+}
+
+void Scheduler::cancel(EVENT event)
+{
+    if(position[event] != EVENT_COUNT)
+        remove(position[event]);
+}
+
+bool Scheduler::isScheduled(EVENT event) const
+{
+    return position[event] != EVENT_COUNT;
+}
+
+uint64_t Scheduler::getEventCycle(EVENT event) const
+{
+    return isScheduled(event) ? heap[position[event]].cycle : NEVER;
+}
+
+void Scheduler::dispatch(uint64_t cycle)
+{
+    while(count && heap[0].cycle <= cycle)
+    {
+        ENTRY due = heap[0];
+        remove(0); // handler may schedule the same event again
+        dispatched++;
+        if(handlers[due.event])
+            handlers[due.event](contexts[due.event],due.cycle);
+    }
+}
+
+bool Scheduler::before(const ENTRY& a,const ENTRY& b) const
+{
+    return a.cycle < b.cycle || (a.cycle == b.cycle && a.event < b.event);
+}
+
+void Scheduler::place(uint8_t index,const ENTRY& entry)
+{
+    heap[index] = entry;
+    position[entry.event] = index;
+}
+
+void Scheduler::siftUp(uint8_t index)
+{
+    ENTRY entry = heap[index];
+    while(index > 0)
+    {
+        uint8_t parent = (index - 1) / 2;
+        if(!before(entry,heap[parent])) break;
+        place(index,heap[parent]);
+        index = parent;
+    }
+    place(index,entry);
+}
+
+void Scheduler::siftDown(uint8_t index)
+{
+    ENTRY entry = heap[index];
+    while(true)
+    {
+        uint8_t child = 2 * index + 1;
+        if(child >= count) break;
+        if(child + 1 < count && before(heap[child + 1],heap[child])) child++;
+        if(!before(heap[child],entry)) break;
+        place(index,heap[child]);
+        index = child;
+    }
+    place(index,entry);
+}
+
+void Scheduler::remove(uint8_t index)
+{
+    position[heap[index].event] = EVENT_COUNT;
+    count--;
+    if(index == count) return;
+
+    ENTRY moved = heap[count];
+    place(index,moved);
+    if(index > 0 && before(moved,heap[(index - 1) / 2])) siftUp(index);
+    else siftDown(index);
+}
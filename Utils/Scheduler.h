@@ -0,0 +1,72 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include "handler.h"
+
+/*
+
+    EVENT SCHEDULER
+
+    Every timed event of the machine (vblank, NMI, IRQ, APU frame counter, mapper IRQ, DMA)
+    is kept here keyed on the CPU cycle it is due, in a small binary heap.
+    The CPU runs until nextEventCycle() and only then calls dispatch(), so nothing is
+    polled per cycle and currentCycle stays the single time source.
+    Each EVENT has at most one pending timestamp, scheduling it again moves it.
+
+*/
+
+class Scheduler
+{
+    public:
+        enum EVENT : uint8_t { PPU_VBLANK, NMI, IRQ, APU_FRAME_COUNTER, MAPPER_IRQ, DMA, EVENT_COUNT };
+
+        using HANDLER = void (*)(void* context,uint64_t cycle); // cycle is the timestamp event was due
+
+        static constexpr uint64_t NEVER = UINT64_MAX;
+
+        Scheduler();
+
+        void setHandler(EVENT event,HANDLER handler,void* context); // subsystem that services event
+
+        void schedule(EVENT event,uint64_t cycle); // (re)schedule event at cycle
+
+        void cancel(EVENT event);
+
+        bool isScheduled(EVENT event) const;
+
+        uint64_t getEventCycle(EVENT event) const; // NEVER if not scheduled
+
+        uint64_t nextEventCycle() const { return count ? heap[0].cycle : NEVER; }
+
+        void dispatch(uint64_t cycle); // run every event due at or before cycle in timestamp order
+
+        uint32_t getDispatchCount() const { return dispatched; } // handlers run so far, wraps
+
+    private:
+        struct ENTRY
+        {
+            uint64_t cycle;
+            EVENT event;
+        };
+
+        uint8_t count = 0; // count and heap[0] are read by nextEventCycle(), keep them first
+        ENTRY heap[EVENT_COUNT];
+        uint8_t position[EVENT_COUNT]; // heap index of each event, EVENT_COUNT when not scheduled
+
+        HANDLER handlers[EVENT_COUNT];
+        void* contexts[EVENT_COUNT];
+
+        uint32_t dispatched = 0;
+
+        bool before(const ENTRY& a,const ENTRY& b) const; // earlier timestamp first, EVENT order breaks ties
+
+        void place(uint8_t index,const ENTRY& entry);
+
+        void siftUp(uint8_t index);
+
+        void siftDown(uint8_t index);
+
+        void remove(uint8_t index);
+};
+
+
+#endif
@@ -4,7 +4,8 @@
 #define ZERO_BIT 1
 #define INTERRUPT_DISABLE_BIT 2
 #define DECIMAL_MODE_BIT 3
-#define BREAK_BIT 5
+#define BREAK_BIT 4
+#define UNUSED_BIT 5
 #define OVERFLOW_BIT 6
 #define NEGATIVE_BIT 7
 